@@ -0,0 +1,256 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <barrier>
+#include <mutex>
+#include <allocators/linear_allocator.h>
+#include <pools/thread_cached_pool.h>
+#include <pools/concurrent_bucket_pool.h>
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// runs `_func(thread_index)` on `thread_count` threads and returns the wall time in seconds
+
+template <class F>
+double run_threads(const std::size_t thread_count, const F& _func)
+{
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count);
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < thread_count; i++)
+		threads.emplace_back([&_func, i]() { _func(i); });
+	for (auto& t : threads)
+		t.join();
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double>(end - start).count();
+}
+
+std::vector<std::size_t> thread_counts()
+{
+	std::vector<std::size_t> r;
+	const std::size_t		 max_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+	for (std::size_t i = 1; i < max_threads; i *= 2)
+		r.push_back(i);
+	r.push_back(max_threads);
+	return r;
+}
+
+void print_result(const char* name, const std::size_t thread_count, const std::size_t op_count, const double seconds)
+{
+	std::cout << std::left << std::setw(40) << name
+			  << " threads: " << std::setw(4) << thread_count
+			  << " Mops/s: " << std::fixed << std::setprecision(2) << (double(op_count) / seconds / 1000000.0)
+			  << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+
+template <class ALLOCATOR>
+void bench_linear_allocator_scaling(const char* name)
+{
+	const std::size_t alloc_size = 16;
+	const std::size_t allocs_per_thread = 1 << 20;
+
+	for (std::size_t thread_count : thread_counts())
+	{
+		ALLOCATOR alc;
+		alc.set_capacity(alloc_size * allocs_per_thread * thread_count * 2);
+
+		double seconds = run_threads(thread_count, [&](std::size_t) {
+			for (std::size_t i = 0; i < allocs_per_thread; i++)
+			{
+				void* volatile p = alc.alloc(alloc_size);
+				(void)p;
+			}
+		});
+		print_result(name, thread_count, allocs_per_thread * thread_count, seconds);
+	}
+}
+
+void bench_threaded_linear_batch(const char* name, const std::size_t batch_size)
+{
+	// same number of 16 byte nodes as bench_linear_allocator_scaling, reserved batch_size at a time
+	struct node
+	{
+		std::uint64_t a, b;
+	};
+	const std::size_t allocs_per_thread = 1 << 20;
+
+	for (std::size_t thread_count : thread_counts())
+	{
+		cppe::threaded_linear_allocator alc;
+		alc.set_capacity(sizeof(node) * allocs_per_thread * thread_count * 2);
+
+		double seconds = run_threads(thread_count, [&](std::size_t) {
+			for (std::size_t i = 0; i < allocs_per_thread; i += batch_size)
+			{
+				auto nodes = alc.alloc_array<node>(batch_size);
+				node* volatile p = nodes.begin();
+				(void)p;
+			}
+		});
+		print_result(name, thread_count, allocs_per_thread * thread_count, seconds);
+	}
+}
+
+template <class ALLOCATOR>
+void bench_overflow_allocator_scaling(const char* name)
+{
+	const std::size_t ops_per_thread = 1 << 16;
+
+	for (std::size_t thread_count : thread_counts())
+	{
+		ALLOCATOR alc;
+
+		double seconds = run_threads(thread_count, [&](std::size_t) {
+			void* ptrs[16];
+			for (std::size_t i = 0; i < ops_per_thread; i += 16)
+			{
+				for (std::size_t j = 0; j < 16; j++)
+					ptrs[j] = alc.alloc(64 + j * 16);
+				for (std::size_t j = 0; j < 16; j++)
+					alc.free(ptrs[j]);
+			}
+		});
+		print_result(name, thread_count, ops_per_thread * thread_count, seconds);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+
+struct small_object
+{
+	std::uint64_t data[4];
+};
+
+// every thread creates a batch of objects and releases it again, `remote` releases the batch of the next thread instead
+// so every release crosses threads
+template <class CREATE, class RELEASE>
+void bench_small_objects(const char* name, const bool remote, const CREATE& _create, const RELEASE& _release)
+{
+	const std::size_t batch_size = 4096; // big batches so the barriers don't dominate
+	const std::size_t rounds = 128;
+
+	for (std::size_t thread_count : thread_counts())
+	{
+		std::vector<std::vector<small_object*>> batches(thread_count, std::vector<small_object*>(batch_size));
+		std::barrier<>							sync { std::ptrdiff_t(thread_count) };
+
+		double seconds = run_threads(thread_count, [&](std::size_t t) {
+			for (std::size_t r = 0; r < rounds; r++)
+			{
+				for (auto& p : batches[t])
+					p = _create();
+				sync.arrive_and_wait();
+				for (auto* p : batches[remote ? (t + 1) % thread_count : t])
+					_release(p);
+				sync.arrive_and_wait();
+			}
+		});
+		print_result(name, thread_count, batch_size * rounds * thread_count * 2, seconds);
+	}
+}
+
+void bench_small_object_allocators()
+{
+	for (bool remote : { false, true })
+	{
+		bench_small_objects(remote ? "new/delete remote" : "new/delete", remote,
+			[]() { return new small_object(); },
+			[](small_object* p) { delete p; });
+
+		cppe::thread_cached_pool<small_object> pool;
+		bench_small_objects(remote ? "thread_cached_pool remote" : "thread_cached_pool", remote,
+			[&]() { return pool.create(); },
+			[&](small_object* p) { pool.release(p); });
+	}
+
+	// the single threaded pool as a baseline, release by handle and by pointer
+	const std::size_t batch_size = 4096;
+	const std::size_t rounds = 128;
+
+	cppe::primitive_bucket_pool<small_object>				  pool;
+	std::vector<cppe::primitive_bucket_pool<small_object>::handle> batch(batch_size);
+	double seconds = run_threads(1, [&](std::size_t) {
+		for (std::size_t r = 0; r < rounds; r++)
+		{
+			for (auto& h : batch)
+				h = pool.create();
+			for (auto& h : batch)
+				pool.release(h);
+		}
+	});
+	print_result("primitive_bucket_pool", 1, batch_size * rounds * 2, seconds);
+
+	std::vector<small_object*> objects(batch_size);
+	seconds = run_threads(1, [&](std::size_t) {
+		for (std::size_t r = 0; r < rounds; r++)
+		{
+			for (auto& p : objects)
+				p = pool.create().ptr;
+			for (auto* p : objects)
+				pool.release(p);
+		}
+	});
+	print_result("primitive_bucket_pool release(T*)", 1, batch_size * rounds * 2, seconds);
+}
+
+// every thread creates a batch of handles from the shared pool and releases them again
+template <class HANDLE, class CREATE, class RELEASE>
+void bench_bucket_pool_scaling(const char* name, const CREATE& _create, const RELEASE& _release)
+{
+	const std::size_t batch_size = 1024;
+	const std::size_t rounds = 256;
+
+	for (std::size_t thread_count : thread_counts())
+	{
+		std::vector<std::vector<HANDLE>> batches(thread_count, std::vector<HANDLE>(batch_size));
+
+		double seconds = run_threads(thread_count, [&](std::size_t t) {
+			for (std::size_t r = 0; r < rounds; r++)
+			{
+				for (auto& h : batches[t])
+					h = _create();
+				for (auto& h : batches[t])
+					_release(h);
+			}
+		});
+		print_result(name, thread_count, batch_size * rounds * thread_count * 2, seconds);
+	}
+}
+
+void bench_bucket_pools()
+{
+	{
+		using pool_t = cppe::primitive_bucket_pool<small_object>;
+		pool_t	   pool;
+		std::mutex lock;
+		bench_bucket_pool_scaling<pool_t::handle>("primitive_bucket_pool + mutex",
+			[&]() { std::lock_guard<std::mutex> _(lock); return pool.create(); },
+			[&](const pool_t::handle& h) { std::lock_guard<std::mutex> _(lock); pool.release(h); });
+	}
+	{
+		using pool_t = cppe::concurrent_bucket_pool<small_object>;
+		pool_t pool;
+		bench_bucket_pool_scaling<pool_t::handle>("concurrent_bucket_pool",
+			[&]() { return pool.create(); },
+			[&](const pool_t::handle& h) { pool.release(h); });
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+	bench_linear_allocator_scaling<cppe::threaded_linear_allocator>("threaded_linear_allocator");
+	bench_linear_allocator_scaling<cppe::thread_cached_linear_allocator>("thread_cached_linear_allocator");
+	bench_threaded_linear_batch("threaded_linear_allocator alloc_array/64", 64);
+	bench_overflow_allocator_scaling<cppe::threaded_overflow_allocator>("threaded_overflow_allocator");
+	bench_overflow_allocator_scaling<cppe::sharded_overflow_allocator>("sharded_overflow_allocator");
+	bench_small_object_allocators();
+	bench_bucket_pools();
+	return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../config/cppelements_config.h"
+#include <atomic>
+#include <array>
+
+namespace cppe
+{
+	// snapshot of allocator statistics returned by stats() on every allocator.
+	// counters are only recorded when CPPE_ALLOCATOR_STATS is defined, otherwise everything stays zero.
+	struct allocator_stats
+	{
+		static constexpr std::size_t histogram_size = 32;
+
+		std::size_t alloc_count = 0;	// successful allocations
+		std::size_t alloc_bytes = 0;	// requested bytes of successful allocations
+		std::size_t free_count = 0;
+		std::size_t failed_count = 0;	// allocations that returned nullptr
+		std::size_t in_use = 0;			// bytes currently allocated, padding included
+		std::size_t peak_in_use = 0;	// high water mark of in_use since the last reset_stats()
+		std::size_t overflow_count = 0; // safe_linear_allocator: allocations served by the fallback allocator
+		std::size_t overflow_bytes = 0;
+
+		std::array<std::size_t, histogram_size> size_histogram {}; // bucket i counts sizes in [2^(i-1), 2^i)
+
+	public:
+		static std::size_t histogram_bucket(const std::size_t sz);
+
+		allocator_stats& operator+=(const allocator_stats& other); // merge, peaks are added as an upper bound
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	namespace detail
+	{
+#ifdef CPPE_ALLOCATOR_STATS
+		// thread safe, counters use relaxed atomics
+		struct allocator_stats_recorder
+		{
+		public:
+			allocator_stats_recorder() = default;
+			allocator_stats_recorder(const allocator_stats_recorder&) = delete;
+			allocator_stats_recorder& operator=(const allocator_stats_recorder&) = delete;
+
+		public:
+			void record_alloc(const std::size_t requested, const std::size_t consumed);
+			void record_failed();
+			void record_free(const std::size_t consumed);
+			void record_resize(const std::size_t old_consumed, const std::size_t new_consumed); // allocation resized in place
+			void record_clear(); // everything is released at once
+
+			allocator_stats snapshot() const;
+			void			reset();
+
+		protected:
+			void update_peak(const std::size_t in_use);
+
+		protected:
+			std::atomic<std::size_t> m_alloc_count { 0 };
+			std::atomic<std::size_t> m_alloc_bytes { 0 };
+			std::atomic<std::size_t> m_free_count { 0 };
+			std::atomic<std::size_t> m_failed_count { 0 };
+			std::atomic<std::size_t> m_in_use { 0 };
+			std::atomic<std::size_t> m_peak_in_use { 0 };
+			std::atomic<std::size_t> m_histogram[allocator_stats::histogram_size];
+		};
+#else
+		struct allocator_stats_recorder
+		{
+		public:
+			cppedecl_finline void record_alloc(const std::size_t, const std::size_t)
+			{
+			}
+			cppedecl_finline void record_failed()
+			{
+			}
+			cppedecl_finline void record_free(const std::size_t)
+			{
+			}
+			cppedecl_finline void record_resize(const std::size_t, const std::size_t)
+			{
+			}
+			cppedecl_finline void record_clear()
+			{
+			}
+
+			cppedecl_finline allocator_stats snapshot() const
+			{
+				return {};
+			}
+			cppedecl_finline void reset()
+			{
+			}
+		};
+#endif
+	}
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "../config/cppelements_config.h"
+#include "allocator_stats.h"
+#include "../array_view.h"
 #include <mutex>
-#include <unordered_set>
+#include <map>
 #include <memory>
 
 namespace cppe
@@ -11,6 +13,42 @@ namespace cppe
 	{
 		using byte_t = unsigned char;
 		using allocation_info_t = std::pair<byte_t*, std::size_t>;
+
+		cppedecl_finline bool is_power_of_two(const std::size_t v)
+		{
+			return v != 0 && (v & (v - 1)) == 0;
+		}
+		cppedecl_finline std::size_t align_up(const std::size_t v, const std::size_t align)
+		{
+			CPPE_ASSERT(is_power_of_two(align));
+			return (v + align - 1) & ~(align - 1);
+		}
+		template <class T>
+		cppedecl_finline T* align_pointer(T* p, const std::size_t align)
+		{
+			return reinterpret_cast<T*>(align_up(reinterpret_cast<std::uintptr_t>(p), align));
+		}
+
+		// size of an alloc_n() batch, false if count * elem_size overflows
+		cppedecl_finline bool batch_size(const std::size_t count, const std::size_t elem_size, const std::size_t align, std::size_t& out)
+		{
+			CPPE_ASSERT(is_power_of_two(align) && (elem_size % align) == 0); // every element has to stay aligned
+			if (elem_size != 0 && count > (std::numeric_limits<std::size_t>::max() - align) / elem_size)
+				return false;
+			out = count * elem_size;
+			return true;
+		}
+		// typed view over an alloc_n() batch, elements are default initialized
+		template <class T>
+		cppedecl_finline array_view<T> make_batch(void* p, const std::size_t count)
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "linear allocators never run destructors");
+			if (p == nullptr)
+				return {};
+			T* r = static_cast<T*>(p);
+			std::uninitialized_default_construct_n(r, count);
+			return array_view<T>(r, count);
+		}
 	}
 
 	template <class T, std::size_t ALIGN = 8>
@@ -29,8 +67,18 @@ namespace cppe
 		return (r + align - 1) & ~(align - 1); 
 	}
 
+	// heap backed allocator used when linear allocators run out of space.
+	// live blocks are indexed by address so owns() is logarithmic; freed blocks are kept in
+	// power of two size classes and reused by later allocations until trim() is called.
+	// blocks are aligned to their size class, capped at max_alignment.
 	struct overflow_allocator
 	{
+	public:
+		static constexpr std::size_t min_size_class_bytes = 16;
+		static constexpr std::size_t max_size_class_bytes = 64 * 1024; // bigger blocks go straight back to the heap
+		static constexpr std::size_t size_class_count = 13;				// 16 .. 64k
+		static constexpr std::size_t max_alignment = 64;
+
 	public:
 		overflow_allocator() = default;
 
@@ -39,16 +87,27 @@ namespace cppe
 		~overflow_allocator();
 
 	public:
-		void clear();
+		void clear(); // live blocks are moved to the free lists
+		void trim();  // returns cached free blocks to the heap
 
 		void* alloc(const std::size_t sz);
+		void* alloc(const std::size_t sz, const std::size_t align); // align <= max_alignment, padding counts in size()
 		void  free(const void* p);
 		bool  try_free(const void* p);
 
 		void swap(overflow_allocator& other);
 
-		std::size_t size() const;
+		std::size_t size() const; // bytes requested by live allocations
 		bool		owns(const void* p) const;
+	public:
+		inline allocator_stats stats() const
+		{
+			return m_stats.snapshot();
+		}
+		inline void reset_stats()
+		{
+			m_stats.reset();
+		}
 
 	public: // danger zone
 		template <class F>
@@ -63,32 +122,26 @@ namespace cppe
 			// allow constructor but prevent copy because allocator contents should not be shared
 		}
 
+		// split alloc()/free() used by sharded_overflow_allocator, the live blocks and the free lists can belong to different instances:
+		void*					alloc_recycled(const std::size_t sz);	 // nullptr if no cached block fits
+		detail::byte_t*			pop_recycled(const std::size_t sz);		 // cached block without tracking it, nullptr if none fits
+		static detail::byte_t*	alloc_block(const std::size_t sz);		 // new untracked block
+		static void				free_block(detail::byte_t* p, const std::size_t sz);
+		void					adopt(detail::byte_t* p, const std::size_t sz); // track a block from alloc_block() or pop_recycled()
+		bool					untrack(const void* p, std::size_t& sz);		// stop tracking a live block, false if not owned
+		void					recycle(detail::byte_t* ptr, const std::size_t sz); // cache an untracked block
+
 	protected:
-		struct entry
-		{
-			const detail::byte_t* ptr;
-			std::size_t			  size;
-			inline bool			  operator<(const entry& other) const
-			{
-				return ptr < other.ptr;
-			}
-			inline bool operator==(const entry& other) const
-			{
-				return ptr == other.ptr;
-			}
-			inline bool operator!=(const entry& other) const
-			{
-				return ptr == other.ptr;
-			}
-		};
-		struct entry_hash
-		{
-			std::size_t operator()(const entry& e) const
-			{
-				return std::hash<const detail::byte_t*> {}(e.ptr);
-			}
-		};
-		std::unordered_set<entry, entry_hash> m_allocations;
+		static std::size_t size_class(const std::size_t sz); // returns size_class_count for oversized blocks
+		static std::size_t size_class_bytes(const std::size_t sc);
+		static std::size_t block_alignment(const std::size_t sc);
+
+	protected:
+		std::map<const detail::byte_t*, std::size_t>  m_allocations; // live block -> requested size
+		std::size_t									  m_size = 0;
+		std::vector<detail::byte_t*>				  m_free_blocks[size_class_count];
+
+		detail::allocator_stats_recorder m_stats;
 	};
 
 	//-------------------------------------------------------------------------------------------------------------
@@ -103,13 +156,18 @@ namespace cppe
 
 	public:
 		void clear();
+		void trim();
 
 		void* alloc(const std::size_t sz);
+		void* alloc(const std::size_t sz, const std::size_t align);
 		void  free(const void* p);
 		bool  try_free(const void* p);
 
-		std::size_t size();
-		bool		owns(const void* p);
+		std::size_t size() const;
+		bool		owns(const void* p) const;
+
+		allocator_stats stats() const;
+		void			reset_stats();
 
 	public: // danger zone
 		template <class F>
@@ -126,12 +184,73 @@ namespace cppe
 		}
 
 	protected:
-		std::mutex		   m_lock;
+		mutable std::mutex m_lock;
 		overflow_allocator m_base;
 	};
 
 	//-------------------------------------------------------------------------------------------------------------
 
+	// lock striped version of threaded_overflow_allocator.
+	// a live block is tracked by the shard its address hashes to, freed blocks are cached by the home shard of the
+	// freeing thread and reused by its next allocations. alloc() and free() lock the home shard and the owner shard,
+	// only aggregate queries (size, owns, clear) visit every shard.
+	struct sharded_overflow_allocator
+	{
+	public:
+		static constexpr std::size_t shard_count = 16; // power of two
+
+		sharded_overflow_allocator() = default;
+		sharded_overflow_allocator& operator=(const sharded_overflow_allocator&) = delete;
+
+		~sharded_overflow_allocator() = default;
+
+	public:
+		void clear();
+		void trim();
+
+		void* alloc(const std::size_t sz);
+		void* alloc(const std::size_t sz, const std::size_t align);
+		void  free(const void* p);
+		bool  try_free(const void* p);
+
+		std::size_t size() const;
+		bool		owns(const void* p) const;
+
+		allocator_stats stats() const;
+		void			reset_stats();
+
+	public: // danger zone
+		template <class F>
+		// void F(overflow_allocator&), called once for every shard
+		inline void intrusive_visit(const F& _func)
+		{
+			for (auto& s : m_shards)
+			{
+				std::lock_guard<std::mutex> _(s.lock);
+				_func(s.base);
+			}
+		}
+		inline sharded_overflow_allocator(const sharded_overflow_allocator&)
+			: sharded_overflow_allocator()
+		{
+			// allow constructor but prevent copy because allocator contents should not be shared
+		}
+
+	protected:
+		static std::size_t home_shard_index();
+		static std::size_t address_shard_index(const void* p);
+
+	protected:
+		struct alignas(64) shard
+		{
+			mutable std::mutex lock;
+			overflow_allocator base;
+		};
+		shard m_shards[shard_count];
+	};
+
+	//-------------------------------------------------------------------------------------------------------------
+
 	template <typename T>
 	struct shared_overflow_allocator
 	{
@@ -160,11 +279,19 @@ namespace cppe
 		{
 			m_allocator->clear();
 		}
+		inline void trim()
+		{
+			m_allocator->trim();
+		}
 
 		inline void* alloc(const std::size_t sz)
 		{
 			return m_allocator->alloc(sz);
 		}
+		inline void* alloc(const std::size_t sz, const std::size_t align)
+		{
+			return m_allocator->alloc(sz, align);
+		}
 		inline void free(const void* p)
 		{
 			m_allocator->free(p);
@@ -173,6 +300,14 @@ namespace cppe
 		{
 			return m_allocator->try_free(p);
 		}
+		inline allocator_stats stats() const
+		{
+			return m_allocator->stats();
+		}
+		inline void reset_stats()
+		{
+			m_allocator->reset_stats();
+		}
 		inline void swap(class_t& other)
 		{
 			std::swap(m_allocator, other.m_allocator);
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "memory.h"
+#include "base_allocator.h"
+#include <algorithm>
+#include <tuple>
 
 namespace cppe
 {
@@ -79,114 +81,198 @@ namespace cppe
 	//----------------------------------------------------------------------------------------
 
 	//----------------------------------------------------------------------------------------
-	// TODO F,T -> variadic
-	template <typename F, typename T>
+	// several arrays packed in a single allocation, e.g. the columns of a structure of arrays.
+	// every array starts at an offset aligned for its type and the block is aligned for the strictest one.
+	// the block comes from any cppe allocator (alloc(sz, align) + free(p)) or from default_allocator<byte_t[]>.
+	// counts are not stored, the caller passes them to destruct() and grow().
+	template <typename... TS>
 	struct ChainBlockPtr
 	{
-	private:
-		F* m_first;
-		T* m_second;
+		static_assert(sizeof...(TS) > 0, "need at least one array");
 
 	public:
-		using class_t = ChainBlockPtr<F, T>;
+		using class_t = ChainBlockPtr<TS...>;
 		using chain_allocator_t = default_allocator<detail::byte_t[]>;
 
-		ChainBlockPtr()
-			: m_first(nullptr)
-			, m_second(nullptr)
+		static constexpr std::size_t array_count = sizeof...(TS);
+		static constexpr std::size_t block_alignment = std::max({ alignof(TS)... });
+
+		using counts_t = std::array<std::size_t, array_count>;
+		template <std::size_t I>
+		using element_t = std::tuple_element_t<I, std::tuple<TS...>>;
+
+		struct layout
+		{
+			std::array<std::size_t, array_count> offsets {};
+			std::size_t							  size = 0;
+		};
+
+	public:
+		ChainBlockPtr() = default;
+		ChainBlockPtr(const class_t&) = default;
+		class_t& operator=(const class_t&) = default;
+
+		template <class AL>
+		ChainBlockPtr(const counts_t& counts, AL& alc)
 		{
+			alloc(counts, alc);
 		}
-		ChainBlockPtr(F* const _f, T* const _t)
-			: m_first(_f)
-			, m_second(_t)
+
+	public:
+		template <std::size_t I>
+		cppedecl_finline element_t<I>* get() const
 		{
+			return std::get<I>(m_arrays);
 		}
-		ChainBlockPtr(const std::nullptr_t, T* const _t, const std::size_t first_count = 1)
-			: m_first(reinterpret_cast<F* const>(reinterpret_cast<detail::byte_t* const>(_t) - sizeof(F) * first_count))
-			, m_second(_t)
+		cppedecl_finline auto* first() const
 		{
+			return get<0>();
 		}
-		ChainBlockPtr(F* const _f, const std::nullptr_t, const std::size_t first_count = 1)
-			: m_first(_f)
-			, m_second(reinterpret_cast<T* const>(reinterpret_cast<detail::byte_t* const>(_f) + sizeof(F) * first_count))
+		cppedecl_finline auto* second() const
 		{
+			return get<1>();
 		}
-		ChainBlockPtr(const std::size_t fc, const std::size_t tc)
+		cppedecl_finline void* block() const
 		{
-
-			alloc(fc, tc);
+			return m_block;
 		}
-		ChainBlockPtr(const class_t&) = default;
-		class_t& operator=(const class_t&) = default;
 
 	public:
-		F* first() const
+		static constexpr counts_t uniform(const std::size_t count) // same element count for every array
 		{
-
-			return m_first;
+			counts_t r {};
+			r.fill(count);
+			return r;
 		}
-		T* second() const
+		static constexpr layout compute_layout(const counts_t& counts)
 		{
-
-			return m_second;
+			// constant counts fold the whole layout at compile time
+			layout			  r;
+			const std::size_t sizes[] = { sizeof(TS)... };
+			const std::size_t aligns[] = { alignof(TS)... };
+			for (std::size_t i = 0; i < array_count; i++)
+			{
+				r.offsets[i] = (r.size + aligns[i] - 1) & ~(aligns[i] - 1);
+				r.size = r.offsets[i] + sizes[i] * counts[i];
+			}
+			return r;
 		}
 
 	public:
-		cppedecl_finline static std::size_t alloc_size_first(const std::size_t count)
+		template <class AL>
+		void* alloc(const counts_t& counts, AL& alc) // allocates the block and default constructs every array
 		{
-			return sizeof(F) * count;
+			const layout l = compute_layout(counts);
+			m_block = alloc_block(l.size, alc);
+			if (m_block == nullptr)
+				return nullptr;
+			bind(l);
+			construct_arrays(counts, std::index_sequence_for<TS...> {});
+			return m_block;
 		}
-		cppedecl_finline static std::size_t alloc_size_second(const std::size_t count)
+		void* alloc(const counts_t& counts)
 		{
-			return sizeof(T) * count;
+			chain_allocator_t alc;
+			return alloc(counts, alc);
 		}
-		void destruct_first(const std::size_t _count)
-		{
 
-			F* o = m_first;
-			for (std::size_t i = 0; i < _count; i++, o++)
-				o->~F();
-		}
-		void destruct_second(const std::size_t _count)
+		void destruct(const counts_t& counts)
 		{
+			destruct_arrays(counts, std::index_sequence_for<TS...> {});
+		}
 
-			T* o = m_second;
-			for (std::size_t i = 0; i < _count; i++, o++)
-				o->~T();
+		template <class AL>
+		void dealloc(AL& alc)
+		{
+			if constexpr (requires(AL& a) { a.free(m_block); })
+				alc.free(m_block);
+			else
+				alc.dealloc(m_block);
+			m_block = nullptr;
+			m_arrays = {};
 		}
-		void destruct(const std::size_t _count_first, const std::size_t _count_second)
+		void dealloc()
 		{
-
-			destruct_first(_count_first);
-			destruct_second(_count_second);
+			chain_allocator_t alc;
+			dealloc(alc);
 		}
 
-	public:
-		template <class _AL>
-		void* alloc(const std::size_t fc, const std::size_t tc, const _AL& alc = chain_allocator_t {})
+		template <class AL>
+		bool grow(const counts_t& old_counts, const counts_t& new_counts, AL& alc)
 		{
-			auto size_first = alloc_size_first(fc);
-			auto size_sec = alloc_size_second(tc);
+			// moves every array into a new block, new elements are default constructed, removed ones destroyed
+			const layout	l = compute_layout(new_counts);
+			detail::byte_t* mm = alloc_block(l.size, alc);
+			if (mm == nullptr)
+				return false;
 
-			detail::byte_t* mm = alc.alloc_n(size_first + size_sec);
+			class_t next;
+			next.m_block = mm;
+			next.bind(l);
+			relocate_arrays(next, old_counts, new_counts, std::index_sequence_for<TS...> {});
 
-			m_first = reinterpret_cast<F*>(mm);
-			m_second = reinterpret_cast<T*>(mm + size_first);
-			new (m_first) F[fc];
-			new (m_second) T[tc];
-			return static_cast<void*>(mm);
+			if (m_block != nullptr)
+				dealloc(alc);
+			*this = next;
+			return true;
+		}
+		bool grow(const counts_t& old_counts, const counts_t& new_counts)
+		{
+			chain_allocator_t alc;
+			return grow(old_counts, new_counts, alc);
 		}
 
-		template <class _AL>
-		cppedecl_finline void dealloc(detail::byte_t* mm, const _AL& alc = chain_allocator_t {})
+	protected:
+		template <class AL>
+		static detail::byte_t* alloc_block(const std::size_t sz, AL& alc)
+		{
+			if constexpr (requires(AL& a) { a.alloc(sz, block_alignment); })
+			{
+				return static_cast<detail::byte_t*>(alc.alloc(sz, block_alignment));
+			}
+			else
+			{
+				static_assert(block_alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "use an allocator with alloc(sz, align)");
+				return alc.alloc_n(sz);
+			}
+		}
+		void bind(const layout& l)
+		{
+			bind_arrays(l, std::index_sequence_for<TS...> {});
+		}
+		template <std::size_t... I>
+		void bind_arrays(const layout& l, std::index_sequence<I...>)
+		{
+			((std::get<I>(m_arrays) = reinterpret_cast<element_t<I>*>(m_block + l.offsets[I])), ...);
+		}
+		template <std::size_t... I>
+		void construct_arrays(const counts_t& counts, std::index_sequence<I...>)
 		{
-			alc.dealloc(mm);
+			(std::uninitialized_default_construct_n(get<I>(), counts[I]), ...);
 		}
-		template <class _AL>
-		cppedecl_finline void dealloc(const _AL& alc = chain_allocator_t {})
+		template <std::size_t... I>
+		void destruct_arrays(const counts_t& counts, std::index_sequence<I...>)
 		{
-			dealloc(static_cast<detail::byte_t*>(m_first), alc);
+			(std::destroy_n(get<I>(), counts[I]), ...);
 		}
+		template <std::size_t... I>
+		void relocate_arrays(const class_t& next, const counts_t& old_counts, const counts_t& new_counts, std::index_sequence<I...>)
+		{
+			(relocate_array(get<I>(), next.template get<I>(), old_counts[I], new_counts[I]), ...);
+		}
+		template <class T>
+		static void relocate_array(T* from, T* to, const std::size_t old_count, const std::size_t new_count)
+		{
+			const std::size_t kept = std::min(old_count, new_count);
+			relocate_n(from, to, kept);
+			if (old_count > kept)
+				std::destroy_n(from + kept, old_count - kept);
+			std::uninitialized_default_construct_n(to + kept, new_count - kept);
+		}
+
+	protected:
+		detail::byte_t*		m_block = nullptr;
+		std::tuple<TS*...>	m_arrays {};
 	};
 	//----------------------------------------------------------------------------------------------------------
 }
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "base_allocator.h"
+#include "linear_storage.h"
+#include <atomic>
+#include <algorithm>
+#include <cstring>
 
 namespace cppe
 {
@@ -14,20 +18,36 @@ namespace cppe
 		~linear_allocator() = default;
 
 	public:
-		void		set_capacity(const std::size_t size);
+		bool		set_capacity(const std::size_t size); // can grow while allocations are alive when using virtual memory, false if the size is not available
 		std::size_t capacity() const;
+
+		bool reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages = false); // false if the address range is not available
+		//^ capacity changes then grow in place without copying, pages are committed when touched
 	public:
 
 		void  clear();
 		void  clear_and_resize_extra(const std::size_t sz);
 		void* alloc(const std::size_t sz); // does what you expect
+		void* alloc(const std::size_t sz, const std::size_t align); // padding counts in size()
+		void* alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align);
+		//^ count contiguous elements with a single bounds check, elem_size must be a multiple of align
 		bool  owns(const void* mem) const; // returns true if memory is owned directly
 
+		bool  try_grow(void* ptr, const std::size_t old_size, const std::size_t new_size);
+		//^ resizes ptr in place if it is the most recent allocation and the buffer has room, can also shrink
+		void* realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align = 1);
+		//^ try_grow() or a new allocation with the old content copied, the old block is not reclaimed
+
 	public:
 		inline void* operator()(const std::size_t sz)
 		{
 			return alloc(sz);
 		}
+		template <class T>
+		inline array_view<T> alloc_array(const std::size_t count) // empty view on failure
+		{
+			return detail::make_batch<T>(alloc_n(count, sizeof(T), alignof(T)), count);
+		}
 		inline void free(const void*)
 		{
 			//empty
@@ -36,10 +56,21 @@ namespace cppe
 		{
 			return m_itr;
 		}
+	public:
+		inline allocator_stats stats() const
+		{
+			return m_stats.snapshot();
+		}
+		inline void reset_stats()
+		{
+			m_stats.reset();
+		}
 	protected:
 		// main buffer data:
 		std::size_t					m_itr{ 0 };
-		std::vector<detail::byte_t> m_storage;
+		linear_storage				m_storage;
+
+		detail::allocator_stats_recorder m_stats;
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -56,33 +87,258 @@ namespace cppe
 		~threaded_linear_allocator() = default;
 
 	public:
-		void		set_capacity(const std::size_t size);
+		bool		set_capacity(const std::size_t size);
+		//^ in virtual mode it can grow while other threads allocate, calls to set_capacity() itself are not thread safe
 		std::size_t capacity() const;
 
+		bool reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages = false); // false if the address range is not available
+		//^ capacity changes then grow in place without copying, pages are committed when touched
+
 	public:
 		void  clear();
 		void  clear_and_resize_extra(const std::size_t sz);
 		void* alloc(const std::size_t sz); // does what you expect
+		void* alloc(const std::size_t sz, const std::size_t align); // reserves sz + align - 1 bytes to keep a single fetch_add
+		void* alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align);
+		//^ count contiguous elements with a single fetch_add, elem_size must be a multiple of align
 		bool  owns(const void* mem) const; // returns true if memory is owned directly
+
+		bool  try_grow(void* ptr, const std::size_t old_size, const std::size_t new_size);
+		//^ CAS on the buffer end, succeeds only if no other allocation happened after ptr.
+		//^ blocks from alloc(sz, align) with align > 1 end before their padding and never grow in place
+		void* realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align = 1);
+		//^ try_grow() or a new allocation with the old content copied, the old block is not reclaimed
 	public:
 		inline void* operator()(const std::size_t sz)
 		{
 			return alloc(sz);
 		}
+		template <class T>
+		inline array_view<T> alloc_array(const std::size_t count) // empty view on failure
+		{
+			return detail::make_batch<T>(alloc_n(count, sizeof(T), alignof(T)), count);
+		}
 		inline void free(const void*)
 		{
 			//empty
 		}
 		inline std::size_t size() const
 		{
-			return m_itr.load();
+			// failed allocations can leave m_itr past the end of the buffer
+			return std::min(m_itr.load(), capacity());
 		}
+	public:
+		inline allocator_stats stats() const
+		{
+			return m_stats.snapshot();
+		}
+		inline void reset_stats()
+		{
+			m_stats.reset();
+		}
+	protected:
+		void* reserve(const std::size_t sz); // alloc() without stats
+
 	protected:
 		// main buffer data:
 		std::atomic<std::size_t>	m_itr { 0 };
-		std::vector<detail::byte_t> m_storage;
+		std::atomic<std::size_t>	m_capacity { 0 }; // m_storage.size() for the allocating threads
+		linear_storage				m_storage;
+
+		detail::allocator_stats_recorder m_stats;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// lock-free linear allocator that grows by chaining chunks instead of failing when full.
+	// the fast path is a single fetch_add on the current chunk, exhausted chunks are replaced using CAS.
+	// allocations bigger than the chunk size get a chunk of their own.
+	// clear() rewinds to the first chunk so all chunks are recycled, memory is released on destruction only.
+	struct threaded_chunked_linear_allocator
+	{
+	public:
+		static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+		threaded_chunked_linear_allocator(const threaded_chunked_linear_allocator&) = delete;
+		threaded_chunked_linear_allocator& operator=(const threaded_chunked_linear_allocator&) = delete;
+		threaded_chunked_linear_allocator() = default;
+		threaded_chunked_linear_allocator(const std::size_t chunk_size);
+		~threaded_chunked_linear_allocator();
+
+	public:
+		void		set_chunk_size(const std::size_t size); // affects only chunks created after the call
+		std::size_t chunk_size() const;
+		std::size_t capacity() const; // sum of all chunk sizes
+
+	public:
+		void		clear(); // not thread safe, rewinds to the first chunk
+		void		clear_and_resize_extra(const std::size_t sz); // appends a chunk of at least sz bytes
+		void*		alloc(const std::size_t sz);				 // never fails
+		void*		alloc(const std::size_t sz, const std::size_t align); // reserves sz + align - 1 bytes
+		bool		owns(const void* mem) const;				 // returns true if memory is owned directly
+		std::size_t size() const;
+
+	public:
+		inline void* operator()(const std::size_t sz)
+		{
+			return alloc(sz);
+		}
+		inline void free(const void*)
+		{
+			//empty
+		}
+	public:
+		inline allocator_stats stats() const
+		{
+			return m_stats.snapshot();
+		}
+		inline void reset_stats()
+		{
+			m_stats.reset();
+		}
+
+	protected:
+		struct alignas(16) chunk
+		{
+			std::atomic<std::size_t> itr { 0 };
+			std::atomic<chunk*>		 next { nullptr };
+			std::size_t				 capacity = 0;
+
+			inline detail::byte_t* data()
+			{
+				return reinterpret_cast<detail::byte_t*>(this + 1);
+			}
+			inline const detail::byte_t* data() const
+			{
+				return reinterpret_cast<const detail::byte_t*>(this + 1);
+			}
+		};
+
+		static chunk* create_chunk(const std::size_t sz);
+		static void	  destroy_chunk(chunk* c);
+
+		chunk* next_chunk(chunk* c, const std::size_t sz);
+
+	protected:
+		std::size_t			m_chunk_size = default_chunk_size;
+		std::atomic<chunk*> m_current { nullptr };
+		std::atomic<chunk*> m_first { nullptr };
+
+		detail::allocator_stats_recorder m_stats;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// threaded_linear_allocator with a per thread cache on top.
+	// each thread reserves a block with one fetch_add and then bump allocates inside it without atomics.
+	// allocations bigger than a quarter of the block go straight to the shared buffer.
+	// size() reports reserved bytes, including the unused tails of the cached blocks.
+	// the base is protected so the shared cursor can't be reset without invalidating the caches.
+	struct thread_cached_linear_allocator : protected threaded_linear_allocator
+	{
+	public:
+		static constexpr std::size_t default_block_size = 64 * 1024;
+
+		thread_cached_linear_allocator(const thread_cached_linear_allocator&) = delete;
+		thread_cached_linear_allocator& operator=(const thread_cached_linear_allocator&) = delete;
+		thread_cached_linear_allocator();
+		thread_cached_linear_allocator(const std::size_t block_size);
+		~thread_cached_linear_allocator() = default;
+
+	public:
+		void		set_block_size(const std::size_t size);
+		std::size_t block_size() const;
+
+		using threaded_linear_allocator::set_capacity;
+		using threaded_linear_allocator::capacity;
+		using threaded_linear_allocator::reserve_virtual_memory;
+
+	public:
+		void  clear(); // invalidates the caches of all threads
+		void  clear_and_resize_extra(const std::size_t sz);
+		void* alloc(const std::size_t sz);
+		void* alloc(const std::size_t sz, const std::size_t align);
+		void* alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align);
+		//^ small batches come from the thread cache like alloc()
+		void* realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align = 1);
+
+		using threaded_linear_allocator::owns;
+		using threaded_linear_allocator::try_grow; // a block at the end of a cache is also at the end of the buffer
+		using threaded_linear_allocator::free;
+		using threaded_linear_allocator::size;
+		using threaded_linear_allocator::stats;
+		using threaded_linear_allocator::reset_stats;
+
+	public:
+		inline void* operator()(const std::size_t sz)
+		{
+			return alloc(sz);
+		}
+		template <class T>
+		inline array_view<T> alloc_array(const std::size_t count) // empty view on failure
+		{
+			return detail::make_batch<T>(alloc_n(count, sizeof(T), alignof(T)), count);
+		}
+
+	protected:
+		struct local_cache
+		{
+			std::uint64_t	token = 0;
+			detail::byte_t* itr = nullptr;
+			detail::byte_t* end = nullptr;
+		};
+		static constexpr std::size_t local_cache_slots = 4;
+		// token is unique across allocator instances and clear() calls, so caches never need explicit invalidation.
+		// slots are searched by token, a new block replaces the slots round robin
+		static thread_local local_cache s_local_caches[local_cache_slots];
+		static thread_local std::size_t s_next_slot;
+
+		cppedecl_finline static local_cache* find_cache(const std::uint64_t token)
+		{
+			for (auto& lc : s_local_caches)
+			{
+				if (lc.token == token)
+					return &lc;
+			}
+			return nullptr;
+		}
+		void* alloc_slow(local_cache* lc, const std::uint64_t token, const std::size_t sz, const std::size_t align);
+		void  renew_token();
+
+	protected:
+		std::size_t				   m_block_size = default_block_size;
+		std::atomic<std::uint64_t> m_token { 0 };
 	};
 
+	inline void* thread_cached_linear_allocator::alloc(const std::size_t sz)
+	{
+		return alloc(sz, 1);
+	}
+	inline void* thread_cached_linear_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		const std::uint64_t token = m_token.load(std::memory_order_relaxed);
+		local_cache*		lc = find_cache(token);
+		if (lc != nullptr)
+		{
+			detail::byte_t* r = detail::align_pointer(lc->itr, align);
+			if (r <= lc->end && std::size_t(lc->end - r) >= sz)
+			{
+				m_stats.record_alloc(sz, std::size_t(r + sz - lc->itr));
+				lc->itr = r + sz;
+				return r;
+			}
+		}
+		return alloc_slow(lc, token, sz, align);
+	}
+	inline void* thread_cached_linear_allocator::alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align)
+	{
+		std::size_t bytes;
+		if (detail::batch_size(count, elem_size, align, bytes))
+			return alloc(bytes, align);
+		m_stats.record_failed();
+		return nullptr;
+	}
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 
 	template <class LALLOC, class FALLOC>
@@ -101,12 +357,22 @@ namespace cppe
 
 	public:
 		void clear();			  // locked, resets allocators to "free" state.
-		void reserve_and_clear(); // if reserve_overflow is true overflow is allocated into
+		void reserve_and_clear(); // grows the linear buffer by the overflow size and releases the overflow memory
 
 		void* alloc(const std::size_t sz); // does what you expect
+		void* alloc(const std::size_t sz, const std::size_t align);
+		void* alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align);
+		void* realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align = 1);
+		//^ grows in the linear buffer when possible, overflow blocks are released after the copy
 
 		bool owns(const void* mem); // returns true if memory is owned directly
 
+		template <class T>
+		inline array_view<T> alloc_array(const std::size_t count)
+		{
+			return detail::make_batch<T>(alloc_n(count, sizeof(T), alignof(T)), count);
+		}
+
 	public:
 		inline void free(const void* mem)
 		{
@@ -122,6 +388,9 @@ namespace cppe
 			return LALLOC::size() + m_overflow_fallback.size();
 		}
 
+		allocator_stats stats() const; // linear stats merged with the fallback, which counts as overflow
+		void			reset_stats();
+
 	public:
 		// danger zone:
 		inline safe_linear_allocator(const FALLOC& alc)
@@ -155,6 +424,7 @@ namespace cppe
 		m_overflow_fallback.intrusive_visit([&](auto& alc) {
 			LALLOC::clear_and_resize_extra(alc.size());
 			alc.clear();
+			alc.trim(); // the linear buffer covers the overflow from now on
 		});
 	}
 
@@ -167,12 +437,62 @@ namespace cppe
 		return r;
 	}
 	template <class LALLOC, class FALLOC>
+	inline void* safe_linear_allocator<LALLOC, FALLOC>::alloc(const std::size_t sz, const std::size_t align)
+	{
+		void* r = this->LALLOC::alloc(sz, align);
+		if (r == nullptr)
+			r = m_overflow_fallback.alloc(sz, align);
+		return r;
+	}
+	template <class LALLOC, class FALLOC>
+	inline void* safe_linear_allocator<LALLOC, FALLOC>::alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align)
+	{
+		void* r = this->LALLOC::alloc_n(count, elem_size, align);
+		std::size_t bytes;
+		if (r == nullptr && detail::batch_size(count, elem_size, align, bytes))
+			r = m_overflow_fallback.alloc(bytes, align);
+		return r;
+	}
+	template <class LALLOC, class FALLOC>
+	inline void* safe_linear_allocator<LALLOC, FALLOC>::realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align)
+	{
+		// once the block moved to the fallback it is not part of the linear buffer anymore
+		if (ptr != nullptr && this->LALLOC::owns(ptr) && this->LALLOC::try_grow(ptr, old_size, new_size))
+			return ptr;
+		void* r = alloc(new_size, align);
+		if (r != nullptr && ptr != nullptr)
+		{
+			std::memcpy(r, ptr, std::min(old_size, new_size));
+			free(ptr);
+		}
+		return r;
+	}
+	template <class LALLOC, class FALLOC>
+	inline allocator_stats safe_linear_allocator<LALLOC, FALLOC>::stats() const
+	{
+		allocator_stats r = LALLOC::stats();
+		allocator_stats o = m_overflow_fallback.stats();
+
+		// every overflow allocation was first a failed linear allocation
+		r.failed_count -= std::min(r.failed_count, o.alloc_count);
+		r += o;
+		r.overflow_count = o.alloc_count;
+		r.overflow_bytes = o.alloc_bytes;
+		return r;
+	}
+	template <class LALLOC, class FALLOC>
+	inline void safe_linear_allocator<LALLOC, FALLOC>::reset_stats()
+	{
+		LALLOC::reset_stats();
+		m_overflow_fallback.reset_stats();
+	}
+	template <class LALLOC, class FALLOC>
 	inline bool safe_linear_allocator<LALLOC, FALLOC>::owns(const void* mem)
 	{
 		if (LALLOC::owns(mem))
 			return true;
 		bool r = false;
-		m_overflow_fallback.intrusive_visit([&](auto& alc) { r = alc.owns(mem); });
+		m_overflow_fallback.intrusive_visit([&](auto& alc) { r = r || alc.owns(mem); });
 		return r;
 	}
 }
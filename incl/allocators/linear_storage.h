@@ -0,0 +1,71 @@
+#pragma once
+
+#include "base_allocator.h"
+
+namespace cppe
+{
+	// contiguous byte buffer used as backing storage by linear allocators.
+	// by default memory comes from the heap and behaves like std::vector (zero filled, copied on growth).
+	// reserve_virtual() switches to a reserved address range instead: resize() grows in place, nothing is copied
+	// or zero filled up front and physical pages are committed when first touched.
+	struct linear_storage
+	{
+	public:
+		linear_storage(const linear_storage&) = delete;
+		linear_storage& operator=(const linear_storage&) = delete;
+		linear_storage() = default;
+		~linear_storage();
+
+	public:
+		bool reserve_virtual(const std::size_t max_size, const bool huge_pages = false); // storage must be empty, false if the range could not be reserved
+		bool resize(const std::size_t sz); // in virtual mode sz is limited to reserved_size(), false if pages could not be committed
+
+		inline bool is_virtual() const
+		{
+			return m_reserved != 0;
+		}
+		inline std::size_t reserved_size() const
+		{
+			return m_reserved;
+		}
+
+	public:
+		inline std::size_t size() const
+		{
+			return m_size;
+		}
+		inline detail::byte_t* data()
+		{
+			return m_data;
+		}
+		inline const detail::byte_t* data() const
+		{
+			return m_data;
+		}
+		inline detail::byte_t& operator[](const std::size_t index)
+		{
+			CPPE_ASSERT(index < m_size);
+			return m_data[index];
+		}
+		inline const detail::byte_t& operator[](const std::size_t index) const
+		{
+			CPPE_ASSERT(index < m_size);
+			return m_data[index];
+		}
+		inline const detail::byte_t& back() const
+		{
+			CPPE_ASSERT(m_size > 0);
+			return m_data[m_size - 1];
+		}
+
+	protected:
+		void release_virtual();
+
+	protected:
+		detail::byte_t*				m_data = nullptr;
+		std::size_t					m_size = 0;
+		std::size_t					m_reserved = 0; // non zero in virtual mode
+		std::size_t					m_committed = 0; // only tracked where commit is explicit (windows)
+		std::vector<detail::byte_t> m_heap;
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "linear_allocator.h"
+#include "scoped_allocator.h"
+#include <memory_resource>
+#include <new>
+
+namespace cppe
+{
+	// std::pmr::memory_resource view over a cppe allocator; the allocator is not owned and must outlive the resource.
+	// linear allocators ignore deallocate(), memory comes back with the allocator clear().
+	// allocation failures throw std::bad_alloc as required by the memory_resource contract.
+	template <class ALLOCATOR>
+	struct allocator_resource : public std::pmr::memory_resource
+	{
+	public:
+		using allocator_t = ALLOCATOR;
+
+		inline allocator_resource(ALLOCATOR& alc)
+			: m_allocator(alc)
+		{
+		}
+		allocator_resource(const allocator_resource&) = delete;
+		allocator_resource& operator=(const allocator_resource&) = delete;
+
+	public:
+		inline ALLOCATOR& allocator() const
+		{
+			return m_allocator;
+		}
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			void* r;
+			if constexpr (requires(ALLOCATOR& a) { a.alloc_linear(bytes, alignment); })
+				r = m_allocator.alloc_linear(bytes, alignment);
+			else
+				r = m_allocator.alloc(bytes, alignment);
+			if (r == nullptr)
+				throw std::bad_alloc();
+			return r;
+		}
+		void do_deallocate(void* p, std::size_t, std::size_t) override
+		{
+			if constexpr (requires(ALLOCATOR& a) { a.free(p); })
+				m_allocator.free(p);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	protected:
+		ALLOCATOR& m_allocator;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------
+
+	using linear_resource = allocator_resource<linear_allocator>;
+	using threaded_linear_resource = allocator_resource<threaded_linear_allocator>;
+	using stack_resource = allocator_resource<stack_allocator>;
+
+	template <class LALLOC, class FALLOC>
+	using safe_linear_resource = allocator_resource<safe_linear_allocator<LALLOC, FALLOC>>;
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "linear_allocator.h"
+#include <limits>
+
+namespace cppe
+{
+	// ring of ARENA_COUNT linear allocators for pipelined work where memory has to outlive a single clear().
+	// alloc(sz) goes to the current arena, alloc_pinned(epoch, sz) to the arena of an epoch pinned by the caller, which
+	// can't be recycled under it. try_advance() moves to the next arena and clears it, but only after every consumer
+	// that pinned that arena's epoch has released it.
+	// LALLOC is any linear allocator (linear_allocator, threaded_linear_allocator, safe_linear_allocator<...>, ...).
+	// advance() and clear() must be called from a single thread, pinning and allocation can happen anywhere
+	// if LALLOC is thread safe.
+	template <class LALLOC, std::size_t ARENA_COUNT = 3>
+	struct ring_allocator
+	{
+		static_assert(ARENA_COUNT >= 2, "a ring needs at least two arenas");
+
+	public:
+		using class_t = ring_allocator<LALLOC, ARENA_COUNT>;
+		using epoch_t = std::uint64_t;
+
+		ring_allocator(const class_t&) = delete;
+		class_t& operator=(const class_t&) = delete;
+		~ring_allocator() = default;
+
+	public:
+		inline ring_allocator()
+		{
+			for (std::size_t i = 1; i < ARENA_COUNT; i++)
+				m_arenas[i].epoch.store(invalid_epoch);
+		}
+
+	public:
+		epoch_t acquire_epoch();					// pins the current arena, returns its epoch
+		void	release_epoch(const epoch_t epoch); // unpins the arena of the epoch
+
+		bool try_advance(); // fails if the next arena is still pinned
+		void clear();		// clears all arenas, nothing can be pinned
+
+		inline epoch_t current_epoch() const
+		{
+			return m_epoch.load();
+		}
+
+	public:
+		inline void* alloc(const std::size_t sz)
+		{
+			return current().alloc.alloc(sz);
+		}
+		inline void* alloc(const std::size_t sz, const std::size_t align)
+		{
+			return current().alloc.alloc(sz, align);
+		}
+		inline void* alloc_pinned(const epoch_t epoch, const std::size_t sz) // epoch must be pinned by the caller
+		{
+			return pinned(epoch).alloc.alloc(sz);
+		}
+		inline void* alloc_pinned(const epoch_t epoch, const std::size_t sz, const std::size_t align)
+		{
+			return pinned(epoch).alloc.alloc(sz, align);
+		}
+		inline void* operator()(const std::size_t sz)
+		{
+			return alloc(sz);
+		}
+		inline void free(const void*)
+		{
+			//empty
+		}
+		inline std::size_t size() const // size of the current arena
+		{
+			return m_arenas[m_epoch.load() % ARENA_COUNT].alloc.size();
+		}
+		bool owns(const void* mem);
+
+	public: // danger zone
+		template <class F>
+		// void F(LALLOC&), called for every arena. used to configure capacity
+		inline void intrusive_visit(const F& _func)
+		{
+			for (auto& a : m_arenas)
+				_func(a.alloc);
+		}
+
+	protected:
+		static constexpr epoch_t invalid_epoch = std::numeric_limits<epoch_t>::max();
+
+		struct alignas(64) arena
+		{
+			LALLOC						alloc;
+			std::atomic<std::uint32_t>	pins { 0 };
+			std::atomic<epoch_t>		epoch { 0 };
+		};
+
+		inline arena& current()
+		{
+			return m_arenas[m_epoch.load() % ARENA_COUNT];
+		}
+		inline arena& pinned(const epoch_t epoch)
+		{
+			arena& a = m_arenas[epoch % ARENA_COUNT];
+			CPPE_ASSERT(a.epoch.load() == epoch && a.pins.load() > 0);
+			return a;
+		}
+
+	protected:
+		arena				 m_arenas[ARENA_COUNT];
+		std::atomic<epoch_t> m_epoch { 0 };
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class LALLOC, std::size_t ARENA_COUNT>
+	inline typename ring_allocator<LALLOC, ARENA_COUNT>::epoch_t ring_allocator<LALLOC, ARENA_COUNT>::acquire_epoch()
+	{
+		while (true)
+		{
+			epoch_t e = m_epoch.load();
+			arena&	a = m_arenas[e % ARENA_COUNT];
+			a.pins.fetch_add(1);
+			// if the ring moved in between, the pin may have landed on an arena that is being recycled
+			if (m_epoch.load() == e)
+				return e;
+			a.pins.fetch_sub(1);
+		}
+	}
+	template <class LALLOC, std::size_t ARENA_COUNT>
+	inline void ring_allocator<LALLOC, ARENA_COUNT>::release_epoch(const epoch_t epoch)
+	{
+		arena& a = m_arenas[epoch % ARENA_COUNT];
+		CPPE_ASSERT(a.epoch.load() == epoch && a.pins.load() > 0);
+		a.pins.fetch_sub(1);
+	}
+
+	template <class LALLOC, std::size_t ARENA_COUNT>
+	inline bool ring_allocator<LALLOC, ARENA_COUNT>::try_advance()
+	{
+		const epoch_t next = m_epoch.load() + 1;
+		arena&		  a = m_arenas[next % ARENA_COUNT];
+		if (a.pins.load() != 0)
+			return false;
+
+		a.alloc.clear();
+		a.epoch.store(next);
+		m_epoch.store(next);
+		return true;
+	}
+	template <class LALLOC, std::size_t ARENA_COUNT>
+	inline void ring_allocator<LALLOC, ARENA_COUNT>::clear()
+	{
+		for (auto& a : m_arenas)
+		{
+			CPPE_ASSERT(a.pins.load() == 0);
+			a.alloc.clear();
+		}
+	}
+
+	template <class LALLOC, std::size_t ARENA_COUNT>
+	inline bool ring_allocator<LALLOC, ARENA_COUNT>::owns(const void* mem)
+	{
+		for (auto& a : m_arenas)
+		{
+			if (a.alloc.owns(mem))
+				return true;
+		}
+		return false;
+	}
+}
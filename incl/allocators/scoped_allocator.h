@@ -1,6 +1,8 @@
 #pragma once
 
 #include "base_allocator.h"
+#include "linear_storage.h"
+#include <limits>
 
 namespace cppe
 {
@@ -22,10 +24,85 @@ namespace cppe
 		std::size_t capacity() const;
 		void		resize(const std::size_t sz);
 
+		bool reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages = false); // false if the address range is not available
+		//^ resize() then grows in place without copying, pages are committed when touched
+
+	public:
+		// spilling: when a scope runs out of space alloc_linear() takes a block from the heap instead of returning nullptr.
+		// spilled blocks belong to the scope and are returned when it unwinds (or on clear()).
+		// scoped_vector always spills, raw stack_allocator scopes only when enabled here.
+		inline void set_spill(const bool enabled)
+		{
+			m_spill_enabled = enabled;
+		}
+		inline bool spill_enabled() const
+		{
+			return m_spill_enabled;
+		}
+		inline std::size_t spill_count() const
+		{
+			// number of allocations that did not fit in the buffer since construction
+			return m_spill_count;
+		}
+		inline std::size_t spill_size() const
+		{
+			// bytes currently spilled by live scopes
+			return m_spill.size();
+		}
+
+	public:
+		// segments: when the innermost scope runs out of room alloc_linear() moves it to an extra segment chained on the
+		// buffer, so the base capacity can stay small and cache hot while outliers still succeed.
+		// segments are taken and given back in scope order and stay cached for reuse, cached bytes above the
+		// cache limit are freed as soon as they are released. growth is checked before spilling.
+		void set_segment_size(const std::size_t sz); // minimum size of an extra segment, 0 disables growth (default)
+		void set_segment_cache_limit(const std::size_t sz); // bytes kept in unused segments
+
+		inline std::size_t segment_size() const
+		{
+			return m_segment_size;
+		}
+		inline std::size_t segment_count() const
+		{
+			// extra segments allocated, in use or cached
+			return m_segments.size();
+		}
+		inline std::size_t active_segment_count() const
+		{
+			return m_segment_top;
+		}
+
+		void trim(); // returns cached segments and spill blocks to the heap
+
+	protected:
+		struct segment
+		{
+			detail::byte_t* data;
+			std::size_t		size;
+		};
+		segment& acquire_segment(const std::size_t min_size);
+		void	 release_segments(const std::size_t count);
+		void	 free_cached_segments(const std::size_t keep_bytes);
+
+	public:
+		allocator_stats stats() const; // shared by all scopes using this buffer, spills count as overflow
+		void			reset_stats();
+
 	protected:
 		stack_allocator* m_head = nullptr;
 
-		std::vector<detail::byte_t> m_storage;
+		linear_storage m_storage;
+
+		std::vector<segment> m_segments;
+		std::size_t			 m_segment_top = 0; // segments [0, m_segment_top) are used by live scopes
+		std::size_t			 m_segment_size = 0;
+		std::size_t			 m_segment_cache_limit = std::numeric_limits<std::size_t>::max();
+
+		overflow_allocator m_spill;
+		std::size_t		   m_spill_count = 0;
+		bool			   m_spill_enabled = false;
+
+		detail::allocator_stats_recorder m_stats;
 
 		friend struct stack_allocator;
 	};
@@ -46,24 +123,33 @@ namespace cppe
 	public:
 		void* alloc_linear(const std::size_t sz);
 		//^ allocates multiple elements right after another in the same space; like a push_back()
+		void* alloc_linear(const std::size_t sz, const std::size_t align);
+		//^ same as above, skips padding bytes so the result is aligned
+		void* alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align);
+		//^ alloc_linear() for count contiguous elements, elem_size must be a multiple of align
 
 		void* alloc_unique(const std::size_t sz);
-		//^ assume only one allocation the can be resized; like a resize();
+		//^ assume only one allocation the can be resized; like a resize(); never spills
 
-		void clear();
+		void clear(); // also returns spilled blocks
 
 	public:
 		inline void* operator()(const std::size_t sz)
 		{
 			return alloc_linear(sz);
 		}
+		template <class T>
+		inline array_view<T> alloc_array(const std::size_t count) // empty view on failure
+		{
+			return detail::make_batch<T>(alloc_n(count, sizeof(T), alignof(T)), count);
+		}
 		inline std::size_t size() const
 		{
-			return m_itr;
+			return m_prev_size + m_itr;
 		}
 		inline std::size_t capacity() const
 		{
-			return m_cap;
+			return m_prev_size + m_cap;
 		}
 		inline std::size_t available_size() const
 		{
@@ -74,12 +160,31 @@ namespace cppe
 			return m_start;
 		}
 
+	protected:
+		bool  next_segment(const std::size_t sz, const std::size_t align);
+		void  release_segments();
+		void* spill(const std::size_t sz, const std::size_t align); // align <= overflow_allocator::max_alignment
+		void  release_spill(void* p);
+		void  release_spills();
+
+		struct spill_block
+		{
+			spill_block* next;
+			std::size_t	 offset; // from the block start to the user pointer
+		};
+
 	protected:
 		stack_allocator_buffer& m_buffer;
 		stack_allocator*		m_parent = nullptr;
 		detail::byte_t*			m_start = nullptr;
 		std::size_t				m_itr = 0;
 		std::size_t				m_cap = 0;
+		std::size_t				m_lent = 0;		 // taken from the parent, given back on destruction
+		std::size_t				m_prev_size = 0; // bytes allocated in regions left behind by next_segment()
+		std::size_t				m_segments = 0;	 // buffer segments acquired by this scope
+		detail::byte_t*			m_origin_start = nullptr;
+		std::size_t				m_origin_cap = 0;
+		spill_block*			m_spills = nullptr;
 	};
 
 	//-----------------------------------------------------------------------------------------------------------
@@ -115,7 +220,7 @@ namespace cppe
 		{
 			for (std::size_t i = 0, s = m_size; i < s; i++)
 			{
-				get_element_ptr(data(), i)->~T();
+				get_element_ptr(m_data, i)->~T();
 			}
 		}
 
@@ -124,18 +229,23 @@ namespace cppe
 		{
 			return m_size;
 		}
+		inline bool spilled() const
+		{
+			// true once the elements were moved out of the stack buffer
+			return m_spill_capacity != 0;
+		}
 
 		inline T& operator [](const std::size_t index)
 		{
 			CPPE_ASSERT(index < m_size);
-			auto* e = get_element_ptr(data(), index);
+			auto* e = get_element_ptr(m_data, index);
 			CPPE_ASSERT(e != nullptr);
 			return *e;
 		}
 		inline const T& operator [](const std::size_t index) const
 		{
 			CPPE_ASSERT(index < m_size);
-			auto* e = get_element_ptr(data(), index);
+			auto* e = get_element_ptr(m_data, index);
 			CPPE_ASSERT(e != nullptr);
 			return *e;
 		}
@@ -153,30 +263,72 @@ namespace cppe
 
 		void push_back(const T& value)
 		{
-			std::size_t		end = m_size++;
-			auto* p = stack_allocator::alloc_unique(get_buffer_size(m_size));
-			CPPE_ASSERT(p != nullptr);
-			new (get_element_ptr(p, end)) T(value);
+			emplace_back(value);
 		}
 		template <class FT>
 		void push_back(FT&& value)
 		{
-			std::size_t		end = m_size++;
-			auto* p = stack_allocator::alloc_unique(get_buffer_size(m_size));
-			CPPE_ASSERT(p != nullptr);
-			new (get_element_ptr(p, end)) T(std::forward<FT>(value));
+			emplace_back(std::forward<FT>(value));
 		}
 		void pop_back()
 		{
 			CPPE_ASSERT(m_size > 0);
 			std::size_t new_sz = --m_size;
-			get_element_ptr(data(), new_sz)->~T();
-			auto* p = stack_allocator::alloc_unique(get_buffer_size(new_sz));
-			CPPE_ASSERT(p != nullptr);
+			get_element_ptr(m_data, new_sz)->~T();
+			if (!spilled())
+			{
+				auto* p = stack_allocator::alloc_unique(get_buffer_size(new_sz));
+				CPPE_ASSERT(p != nullptr);
+			}
 		}
 
+	protected:
+		template <class... ARGS>
+		void emplace_back(ARGS&&... args)
+		{
+			if (T* slot = next_slot())
+			{
+				new (slot) T(std::forward<ARGS>(args)...);
+				m_size++;
+				return;
+			}
+
+			// out of space, move everything to a bigger spilled block.
+			// the new element is constructed first so push_back(v[i]) stays valid
+			std::size_t capacity = std::max<std::size_t>(m_size * 2, 8);
+			T*			p = static_cast<T*>(stack_allocator::spill(get_buffer_size(capacity), alignof(T)));
+			CPPE_ASSERT(p != nullptr);
+			new (get_element_ptr(p, m_size)) T(std::forward<ARGS>(args)...);
+			for (std::size_t i = 0; i < m_size; i++)
+			{
+				new (get_element_ptr(p, i)) T(std::move(*get_element_ptr(m_data, i)));
+				get_element_ptr(m_data, i)->~T();
+			}
+
+			if (spilled())
+				stack_allocator::release_spill(m_data);
+			else
+				stack_allocator::alloc_unique(0); // the stack space goes back to the scope
 
+			m_data = p;
+			m_spill_capacity = capacity;
+			m_size++;
+		}
+		T* next_slot()
+		{
+			if (spilled())
+				return (m_size < m_spill_capacity) ? get_element_ptr(m_data, m_size) : nullptr;
 
+			void* p = stack_allocator::alloc_unique(get_buffer_size(m_size + 1));
+			if (p == nullptr)
+				return nullptr;
+			m_data = static_cast<T*>(p);
+			return get_element_ptr(p, m_size);
+		}
+
+	protected:
+		T*			m_data = nullptr;
+		std::size_t m_spill_capacity = 0;
 	protected:
 		std::size_t m_size = 0;
 	};
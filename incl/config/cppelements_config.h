@@ -10,6 +10,8 @@
 
 #define CPPE_POOL_VALIDATION // depends on CPPE_ENABLE_ASSERT
 
+//#define CPPE_ALLOCATOR_STATS // allocation counters, peak usage and size histograms, see allocators/allocator_stats.h
+
 //--------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------
 
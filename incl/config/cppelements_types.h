@@ -3,6 +3,10 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
 #ifndef CPPE_DEV_PLATFORM
 #	include <utility>
 #endif
@@ -50,6 +54,32 @@ namespace cppe
 		return deferred_call<F>(std::forward<F>(_f));
 	}
 
+	// types that can be moved to a new address with a memcpy and without running the destructor of the source.
+	// specialize for types that own resources through pointers but never point into themselves.
+	template <class T>
+	struct is_trivially_relocatable : public std::is_trivially_copyable<T>
+	{
+	};
+
+	// moves count objects into uninitialized memory at `to`, the sources are destroyed
+	template <class T>
+	cppedecl_finline void relocate_n(T* from, T* to, const std::size_t count)
+	{
+		if constexpr (is_trivially_relocatable<T>::value)
+		{
+			if (count != 0)
+				std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), sizeof(T) * count);
+		}
+		else
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				new (to + i) T(std::move(from[i]));
+				from[i].~T();
+			}
+		}
+	}
+
 	template <class T>
 	cppedecl_finline uint_fast32_t start_end_distance(const T* _start, const T* _end)
 	{
@@ -2,6 +2,11 @@
 #pragma once
 
 #include "../config/cppelements_config.h"
+#include "../vecmap.h"
+#include "occupancy_bitmap.h"
+#include <memory>
+#include <vector>
+#include <limits>
 
 namespace cppe
 {
@@ -12,12 +17,17 @@ namespace cppe
 	{
 	protected:
 		friend class AbstractEntryContainer;
+		friend class TypeClusteredEntryContainer;
 
-		AbstractPoolEntry* left = nullptr;
+		union
+		{
+			AbstractPoolEntry* left = nullptr;
+			void* page; //TypeClusteredEntryContainer, page holding the entry
+		};
 		AbstractPoolEntry* right = nullptr;
 
 	public:
-		inline const void* get_entry_memory() const
+		virtual const void* get_entry_memory() const
 		{
 			//hack to solve multiple inheritance problem
 			return this;
@@ -26,6 +36,11 @@ namespace cppe
 		{
 			//empty
 		}
+		virtual std::size_t get_entry_size_class() const
+		{
+			//only objects created by AbstractPool know their free list
+			return std::numeric_limits<std::size_t>::max();
+		}
 	public:
 		virtual ~AbstractPoolEntry();
 	};
@@ -35,7 +50,7 @@ namespace cppe
 	class AbstractPoolEntryEx : public AbstractPoolEntry
 	{
 	public:
-		inline const void* get_entry_memory() const
+		const void* get_entry_memory() const override
 		{
 			return m_entry_ptr;
 		}
@@ -75,13 +90,118 @@ namespace cppe
 			}
 		}
 	public:
+		template <class T, class... ARGS>
+		static T* construct(void * m, ARGS&&... args)
+		{
+			T* r;
+			if constexpr(sizeof...(ARGS) == 0)
+				r = new (m) T{};
+			else
+				r = new (m) T(std::forward<ARGS>(args)...);
+			r->set_entry_memory(m);
+			return r;
+		}
 		template <class T>
-		static T* construct(void * m)
+		static const void* destruct_entry(T* eptr)
+		{
+			auto* r = eptr->get_entry_memory();
+			eptr->~T();
+			return r;
+		}
+
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	//container policy that places entries itself: every concrete type gets its own pages of 64 slots,
+	//so visit<T>() walks contiguous arrays of T without touching other types.
+	//pages come from the pool allocator and are only returned by clear(), released slots are reused by the same type.
+	//calls made through a T& are devirtualized when T (or the called method) is final.
+	class TypeClusteredEntryContainer
+	{
+	public:
+		using base_entry_t = AbstractPoolEntry;
+
+		static constexpr std::size_t page_slots = occupancy_bitmap::word_bits;
+
+	public:
+		template <class T, class ALLOCATOR, class... ARGS>
+		T* create_entry(ALLOCATOR& alc, ARGS&&... args)
 		{
-			auto* r = new (m) T{};
+			static_assert(std::is_base_of<AbstractPoolEntry, T>::value);
+
+			cluster& c = get_cluster<T>();
+			if(c.free_slots.empty())
+			{
+				void* m = alc.alloc(c.page_bytes, c.page_alignment);
+				CPPE_ASSERT(m != nullptr);
+				add_page(c, m);
+			}
+			const free_slot f = c.free_slots.back();
+			c.free_slots.pop_back();
+
+			void* m = page_data(c, f.page) + f.index * c.slot_size;
+			auto* r = new (m) T(std::forward<ARGS>(args)...);
 			r->set_entry_memory(m);
+
+			occupancy_bitmap::set(&f.page->occupancy, f.index);
+			static_cast<AbstractPoolEntry*>(r)->page = f.page;
 			return r;
 		}
+		template <class T>
+		void release_entry(T* e)
+		{
+			//T can be a base class, the entry subobject is always inside the slot
+			AbstractPoolEntry* entry = e;
+			page_header*	   p = static_cast<page_header*>(entry->page);
+			cluster&		   c = *p->owner;
+			const std::size_t  i = slot_index(c, p, entry);
+
+			e->~T();
+			occupancy_bitmap::reset(&p->occupancy, i);
+			c.free_slots.push_back({ p, i });
+		}
+
+		void add_entry(AbstractPoolEntry*)
+		{
+			//empty, create_entry() does the work
+		}
+		void remove_entry(AbstractPoolEntry*)
+		{
+			//empty, release_entry() does the work
+		}
+		void clear(); //drops every page, the allocator owns the memory
+
+	public:
+		//every live entry, type by type
+		template <class F>
+		void visit(const F& _func)
+		{
+			for(auto& i : m_clusters)
+			{
+				cluster& c = *i.second;
+				for(page_header* p : c.pages)
+				{
+					byte_t* data = page_data(c, p);
+					occupancy_bitmap::visit(&p->occupancy, 1, [&](const std::size_t s) { _func(c.entry_of(data + s * c.slot_size)); });
+				}
+			}
+		}
+		//_func(T&) for every live object created as T (not for types derived from T)
+		template <class T, class F>
+		void visit(const F& _func)
+		{
+			auto* c = m_clusters.find(type_key<T>());
+			if(c == nullptr)
+				return;
+			for(page_header* p : (*c)->pages)
+			{
+				T* data = reinterpret_cast<T*>(page_data(**c, p));
+				occupancy_bitmap::visit(&p->occupancy, 1, [&](const std::size_t s) { _func(*std::launder(data + s)); });
+			}
+		}
+
+	public:
 		template <class T>
 		static const void* destruct_entry(T* eptr)
 		{
@@ -90,38 +210,161 @@ namespace cppe
 			return r;
 		}
 
+	protected:
+		using byte_t = unsigned char;
+
+		struct cluster;
+		struct page_header
+		{
+			cluster*				 owner;
+			occupancy_bitmap::word_t occupancy;
+		};
+		struct free_slot
+		{
+			page_header* page;
+			std::size_t	 index;
+		};
+		struct cluster
+		{
+			std::size_t slot_size;
+			std::size_t data_offset; //from the page start, aligned for the type
+			std::size_t page_bytes;
+			std::size_t page_alignment;
+			AbstractPoolEntry* (*entry_of)(void*);
+
+			std::vector<page_header*> pages; //allocation order
+			std::vector<free_slot>	  free_slots; //lowest address on top
+		};
+
+		template <class T>
+		static const void* type_key()
+		{
+			static const char key = 0;
+			return &key;
+		}
+		template <class T>
+		cluster& get_cluster()
+		{
+			if(auto* c = m_clusters.find(type_key<T>()))
+				return **c;
+
+			auto c = std::make_unique<cluster>();
+			c->slot_size = sizeof(T);
+			c->data_offset = (sizeof(page_header) + alignof(T) - 1) & ~(alignof(T) - 1);
+			c->page_bytes = c->data_offset + sizeof(T) * page_slots;
+			c->page_alignment = std::max(alignof(page_header), alignof(T));
+			c->entry_of = [](void* m) -> AbstractPoolEntry* { return std::launder(static_cast<T*>(m)); };
+			return *m_clusters.insert(type_key<T>(), std::move(c));
+		}
+
+		static byte_t* page_data(const cluster& c, page_header* p)
+		{
+			return reinterpret_cast<byte_t*>(p) + c.data_offset;
+		}
+		static std::size_t slot_index(const cluster& c, page_header* p, const void* m)
+		{
+			return std::size_t(static_cast<const byte_t*>(m) - page_data(c, p)) / c.slot_size;
+		}
+		static void add_page(cluster& c, void* m);
+
+	protected:
+		vecmap<const void*, std::unique_ptr<cluster>> m_clusters;
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
 
+	namespace detail
+	{
+		std::size_t next_abstract_pool_size_class();
+
+		//free list index shared by every type with the same slot size and alignment
+		template <std::size_t SIZE, std::size_t ALIGN>
+		std::size_t abstract_pool_size_class()
+		{
+			static const std::size_t index = next_abstract_pool_size_class();
+			return index;
+		}
+
+		//what AbstractPool::create<T>() constructs in the slot, release() gets the slot and its free list from the
+		//entry hooks even through a base pointer
+		template <class T, std::size_t SIZE>
+		class abstract_pool_entry final : public T
+		{
+		public:
+			abstract_pool_entry()
+				: T{}
+			{
+			}
+			template <class... ARGS>
+			explicit abstract_pool_entry(ARGS&&... args)
+				: T(std::forward<ARGS>(args)...)
+			{
+			}
+
+			const void* get_entry_memory() const override
+			{
+				return this;
+			}
+			std::size_t get_entry_size_class() const override
+			{
+				return abstract_pool_size_class<SIZE, alignof(T)>();
+			}
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
 	template <class ALLOCATOR, class CONTAINER = AbstractEntryContainer>
 	class AbstractPool : public ALLOCATOR, public CONTAINER
 	{
 	public:
 		using base_entry_t = CONTAINER::base_entry_t;
 	public:
-		template <class T>
-		T* create()
-		{
-			//TODO: constructo args when needed
-			constexpr std::size_t sz = alloc_size<T>();
-			void* m = ALLOCATOR::alloc(sz);
-			CPPE_ASSERT(m != nullptr);
-			
-			auto* r = typename CONTAINER::construct<T>(m);
-			CONTAINER::add_entry(r);
-			return r;
-		}
+		//released slots go to a free list per size class and are reused before the allocator is asked for memory
+		template <class T, class... ARGS>
+		T* create(ARGS&&... args)
+		{
+			if constexpr(requires(CONTAINER& c, ALLOCATOR& a) { c.template create_entry<T>(a, std::forward<ARGS>(args)...); })
+			{
+				return CONTAINER::template create_entry<T>(static_cast<ALLOCATOR&>(*this), std::forward<ARGS>(args)...);
+			}
+			else
+			{
+				static_assert(!std::is_final<T>::value, "the pool constructs a type derived from T");
+				using entry_t = detail::abstract_pool_entry<T, alloc_size<T>()>;
+				static_assert(sizeof(entry_t) == sizeof(T));
+
+				void* m = pop_free_slot(detail::abstract_pool_size_class<alloc_size<T>(), alignof(T)>());
+				if(m == nullptr)
+				{
+					m = ALLOCATOR::alloc(alloc_size<T>(), alignof(T));
+					CPPE_ASSERT(m != nullptr);
+				}
 
+				T* r = CONTAINER::template construct<entry_t>(m, std::forward<ARGS>(args)...);
+				CONTAINER::add_entry(r);
+				return r;
+			}
+		}
 
+		//T can be any base of the created type, the slot is recycled for the size it was created with
 		template <class T>
 		void release(T * e)
 		{
 			CPPE_ASSERT(e != nullptr);
-			
-			CONTAINER::remove_entry(e);
-			const void* m = typename CONTAINER::destruct_entry(e);
-			ALLOCATOR::free(m);
+			if constexpr(requires(CONTAINER& c, T* p) { c.release_entry(p); })
+			{
+				CONTAINER::release_entry(e);
+			}
+			else
+			{
+				CONTAINER::remove_entry(e);
+				const std::size_t sc = e->get_entry_size_class();
+				CPPE_ASSERT(sc != std::numeric_limits<std::size_t>::max()); //not created by an AbstractPool
+				void* m = const_cast<void*>(CONTAINER::destruct_entry(e));
+				if(sc != std::numeric_limits<std::size_t>::max())
+					push_free_slot(sc, m);
+			}
 		}
 
 	public:
@@ -132,9 +375,24 @@ namespace cppe
 				CONTAINER::destruct_entry(e);
 			});
 			CONTAINER::clear();
+			m_free_slots.clear();
 			ALLOCATOR::clear();
 		}
-		
+		void trim() //gives the recycled slots back to the allocator
+		{
+			for(void* head : m_free_slots)
+			{
+				void* m = head;
+				while(m != nullptr)
+				{
+					void* next = *static_cast<void**>(m);
+					ALLOCATOR::free(m);
+					m = next;
+				}
+			}
+			m_free_slots.clear();
+		}
+
 	protected:
 		template <class T>
 		constexpr static std::size_t alloc_size()
@@ -143,6 +401,26 @@ namespace cppe
 			std::size_t r = sizeof(T);
 			return (r + align - 1) & ~(align - 1); 
 		}
+
+		void* pop_free_slot(const std::size_t sc)
+		{
+			if(sc >= m_free_slots.size() || m_free_slots[sc] == nullptr)
+				return nullptr;
+			void* r = m_free_slots[sc];
+			m_free_slots[sc] = *static_cast<void**>(r);
+			return r;
+		}
+		void push_free_slot(const std::size_t sc, void* m)
+		{
+			//free slots are linked through their first bytes, every entry is at least a vtable pointer
+			if(sc >= m_free_slots.size())
+				m_free_slots.resize(sc + 1, nullptr);
+			*static_cast<void**>(m) = m_free_slots[sc];
+			m_free_slots[sc] = m;
+		}
+
+	protected:
+		std::vector<void*> m_free_slots; //size class -> intrusive list of released slots
 	};
 
 }
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "primitive_bucket_pool.h"
+#include "../allocators/custom_allocators.h"
+#include <atomic>
+#include <bit>
+
+namespace cppe
+{
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// thread safe primitive_bucket_pool without locks.
+	// buckets have the same power of two layout but are published through an atomic table and never move, so T* stays
+	// valid for the lifetime of the pool. released indices go on a lock-free stack whose head carries a tag that
+	// changes on every update, which makes the pop CAS immune to ABA. unused indices are handed out with a fetch_add.
+	template <class T, std::size_t BUCKET_SKIP_COUNT = 0>
+	struct concurrent_bucket_pool : public bucket_helper
+	{
+	public:
+		struct handle
+		{
+		public:
+			T* ptr = nullptr;
+
+		private:
+			std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+			friend struct concurrent_bucket_pool<T, BUCKET_SKIP_COUNT>;
+
+		public:
+			inline void reset()
+			{
+				(*this) = handle {};
+			}
+			inline bool operator==(const std::nullptr_t) const
+			{
+				return ptr == nullptr;
+			}
+			inline bool operator!=(const std::nullptr_t) const
+			{
+				return ptr != nullptr;
+			}
+#ifdef CPPE_TESTING
+			inline std::uint32_t get_debug_index() const
+			{
+				// used for validation only
+				return index - first_index;
+			}
+#endif
+		};
+
+		using class_t = concurrent_bucket_pool<T, BUCKET_SKIP_COUNT>;
+		using handle_t = handle;
+
+		static constexpr std::size_t   bucket_table_size = 32 - BUCKET_SKIP_COUNT;
+		static constexpr std::uint32_t first_index = (std::uint32_t(1) << BUCKET_SKIP_COUNT) - 1;
+
+	public:
+		concurrent_bucket_pool() = default;
+		concurrent_bucket_pool(const class_t&) = delete;
+		class_t& operator=(const class_t&) = delete;
+
+		~concurrent_bucket_pool()
+		{
+#ifdef CPPE_POOL_VALIDATION
+			validate_empty();
+#endif
+			destroy_objects();
+			for (std::size_t i = 0; i < bucket_table_size; i++)
+			{
+				bucket* b = m_buckets[i].load(std::memory_order_relaxed);
+				if (b != nullptr)
+					destroy_bucket(b, i);
+			}
+		}
+
+#ifdef CPPE_POOL_VALIDATION
+		void validate_empty()
+		{
+			// make sure everything is deallocated, every index handed out must be back on the free stack
+			std::size_t free_count = 0;
+			for (std::uint32_t i = m_free_head.load().index; i != invalid_index; i = link(i).load())
+				free_count++;
+			CPPE_ASSERT(free_count == (m_next_index.load() - first_index));
+		}
+#endif
+
+	public:
+		template <class... ARGS>
+		handle create(ARGS&&... args) // constructs in place, default initialized without args
+		{
+			handle h;
+			h.index = pop_free();
+			if (h.index == invalid_index)
+			{
+				h.index = m_next_index.fetch_add(1, std::memory_order_relaxed);
+				CPPE_ASSERT(h.index != invalid_index); // index space exhausted
+			}
+			auto loc = locate(h.index);
+			void* p = acquire_bucket(loc.bucket_index)->template get<1>()[loc.data_index].bytes;
+			if constexpr (sizeof...(ARGS) == 0)
+				h.ptr = new (p) T;
+			else
+				h.ptr = new (p) T(std::forward<ARGS>(args)...);
+			return h;
+		}
+		cppedecl_finline void release(const handle& h)
+		{
+			h.ptr->~T();
+			push_free(h.index);
+		}
+		void release(const T* pv)
+		{
+			for (std::size_t i = 0; i < bucket_table_size; i++)
+			{
+				bucket* b = m_buckets[i].load(std::memory_order_acquire);
+				if (b == nullptr)
+					continue; // buckets can be published out of order, a later one may exist
+				const T* data = reinterpret_cast<const T*>(b->template get<1>());
+				if (data <= pv && pv < (data + bucket_size(i)))
+				{
+					pv->~T();
+					push_free(bucket_index_to_element_index(uint_fast32_t(i + BUCKET_SKIP_COUNT)) + start_end_distance(data, pv));
+					return;
+				}
+			}
+			CPPE_ASSERT(false); // object is not part of this pool
+		}
+
+		void clear() // not thread safe, destroys every live object
+		{
+			destroy_objects();
+			m_free_head.store(tagged_index {}, std::memory_order_relaxed);
+			m_next_index.store(first_index, std::memory_order_relaxed);
+		}
+
+	protected:
+		static constexpr std::uint32_t invalid_index = std::numeric_limits<std::uint32_t>::max();
+
+		// raw storage, objects only exist between create() and release()
+		struct slot
+		{
+			alignas(T) unsigned char bytes[sizeof(T)];
+		};
+		// bucket i holds the next links of the free stack and the objects
+		using bucket = ChainBlockPtr<std::atomic<std::uint32_t>, slot>;
+
+		struct alignas(8) tagged_index
+		{
+			std::uint32_t index = invalid_index;
+			std::uint32_t tag = 0;
+		};
+
+		cppedecl_finline static std::size_t bucket_size(const std::size_t table_index)
+		{
+			return bucket_index_to_bucket_size(uint_fast32_t(table_index + BUCKET_SKIP_COUNT));
+		}
+		cppedecl_finline static bucket_info locate(const std::uint32_t index)
+		{
+			// same as info_from_index() without the call
+			const uint_fast32_t bi = uint_fast32_t(std::bit_width(std::uint64_t(index) + 1) - 1);
+			CPPE_ASSERT(BUCKET_SKIP_COUNT <= bi);
+			return { bi - uint_fast32_t(BUCKET_SKIP_COUNT), uint_fast32_t(index - ((std::uint64_t(1) << bi) - 1)) };
+		}
+
+		bucket* acquire_bucket(const std::size_t table_index)
+		{
+			bucket* b = m_buckets[table_index].load(std::memory_order_acquire);
+			if (b != nullptr)
+				return b;
+
+			// first user of the bucket publishes it, losers drop their copy
+			bucket* created = new bucket(bucket::uniform(bucket_size(table_index)), m_block_allocator);
+			if (m_buckets[table_index].compare_exchange_strong(b, created, std::memory_order_acq_rel))
+				return created;
+			destroy_bucket(created, table_index);
+			return b;
+		}
+		void destroy_bucket(bucket* b, const std::size_t table_index)
+		{
+			b->destruct(bucket::uniform(bucket_size(table_index)));
+			b->dealloc(m_block_allocator);
+			delete b;
+		}
+
+		void destroy_objects() // not thread safe
+		{
+			if constexpr (!std::is_trivially_destructible<T>::value)
+			{
+				// live objects are the handed out indices that are not on the free stack
+				const std::uint32_t						count = m_next_index.load(std::memory_order_acquire) - first_index;
+				std::vector<occupancy_bitmap::word_t>	released(occupancy_bitmap::word_count(count), 0);
+				for (std::uint32_t i = m_free_head.load(std::memory_order_acquire).index; i != invalid_index; i = link(i).load(std::memory_order_relaxed))
+					occupancy_bitmap::set(released.data(), i - first_index);
+				for (std::uint32_t i = 0; i < count; i++)
+				{
+					if (!occupancy_bitmap::test(released.data(), i))
+					{
+						auto loc = locate(i + first_index);
+						std::launder(reinterpret_cast<T*>(m_buckets[loc.bucket_index].load(std::memory_order_relaxed)->template get<1>()[loc.data_index].bytes))->~T();
+					}
+				}
+			}
+		}
+
+		std::atomic<std::uint32_t>& link(const std::uint32_t index) const
+		{
+			auto loc = locate(index);
+			return m_buckets[loc.bucket_index].load(std::memory_order_acquire)->template get<0>()[loc.data_index];
+		}
+
+		std::uint32_t pop_free()
+		{
+			tagged_index head = m_free_head.load(std::memory_order_acquire);
+			while (head.index != invalid_index)
+			{
+				// link() may be stale if head was popped meanwhile, the tag makes the CAS fail in that case
+				const tagged_index next { link(head.index).load(std::memory_order_relaxed), head.tag + 1 };
+				if (m_free_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+					return head.index;
+			}
+			return invalid_index;
+		}
+		void push_free(const std::uint32_t index)
+		{
+			std::atomic<std::uint32_t>& l = link(index);
+			tagged_index				head = m_free_head.load(std::memory_order_relaxed);
+			tagged_index				next;
+			do
+			{
+				l.store(head.index, std::memory_order_relaxed);
+				next = { index, head.tag + 1 };
+			} while (!m_free_head.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+	protected:
+		alignas(64) std::atomic<tagged_index> m_free_head {};
+		alignas(64) std::atomic<std::uint32_t> m_next_index { first_index };
+		alignas(64) std::atomic<bucket*> m_buckets[bucket_table_size] {};
+
+		typename bucket::chain_allocator_t m_block_allocator;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../config/cppelements_config.h"
+#include <bit>
+
+namespace cppe
+{
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// one bit per pool slot, set while the slot holds a live object
+	struct occupancy_bitmap
+	{
+	public:
+		using word_t = std::uint64_t;
+		static constexpr std::size_t word_bits = 64;
+
+	public:
+		cppedecl_finline static std::size_t word_count(const std::size_t bit_count)
+		{
+			return (bit_count + word_bits - 1) / word_bits;
+		}
+		cppedecl_finline static void set(word_t* words, const std::size_t index)
+		{
+			CPPE_ASSERT(test(words, index) == false);
+			words[index / word_bits] |= word_t(1) << (index % word_bits);
+		}
+		cppedecl_finline static void reset(word_t* words, const std::size_t index)
+		{
+			CPPE_ASSERT(test(words, index) == true); // released twice
+			words[index / word_bits] &= ~(word_t(1) << (index % word_bits));
+		}
+		cppedecl_finline static bool test(const word_t* words, const std::size_t index)
+		{
+			return (words[index / word_bits] & (word_t(1) << (index % word_bits))) != 0;
+		}
+
+		// calls _func(index) for every set bit in ascending order, empty words cost a single compare
+		template <class F>
+		static void visit(const word_t* words, const std::size_t count, const F& _func)
+		{
+			for (std::size_t w = 0; w < count; w++)
+			{
+				for (word_t bits = words[w]; bits != 0; bits &= bits - 1)
+					_func(w * word_bits + std::size_t(std::countr_zero(bits)));
+			}
+		}
+		static std::size_t popcount(const word_t* words, const std::size_t count)
+		{
+			std::size_t r = 0;
+			for (std::size_t w = 0; w < count; w++)
+				r += std::size_t(std::popcount(words[w]));
+			return r;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+}
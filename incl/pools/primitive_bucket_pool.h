@@ -2,10 +2,12 @@
 #pragma once
 
 #include "../config/cppelements_config.h"
+#include "occupancy_bitmap.h"
 #include <vector>
-#ifdef CPPE_POOL_VALIDATION
-#	include <algorithm>
-#endif
+#include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <limits>
 
 namespace cppe
 {
@@ -21,39 +23,25 @@ namespace cppe
 			uint_fast32_t data_index;
 		};
 
-	public:
-		static bucket_info	 info_from_index(const uint_fast32_t index);
-		static uint_fast32_t bucket_index_to_bucket_size(const uint_fast32_t index);
-		static uint_fast32_t bucket_index_to_element_index(const uint_fast32_t index);
-	};
-
-	//--------------------------------------------------------------------------------------------------------------------------------
-
-	template <class T, std::size_t BUCKET_SKIP_COUNT = 0>
-	struct primitive_bucket_pool : public bucket_helper
-	{
-	public:
-		struct handle
+		// element index handed out by the pools built on this bucket layout
+		template <std::size_t BUCKET_SKIP_COUNT>
+		struct index_handle
 		{
 		public:
-			T* ptr = nullptr;
-
-		private:
 			uint_fast32_t index = std::numeric_limits<uint_fast32_t>::max();
-			friend struct primitive_bucket_pool<T, BUCKET_SKIP_COUNT>;
 
 		public:
 			inline void reset()
 			{
-				(*this) = handle {};
+				(*this) = index_handle {};
 			}
 			inline bool operator==(const std::nullptr_t) const
 			{
-				return ptr == nullptr;
+				return index == std::numeric_limits<uint_fast32_t>::max();
 			}
 			inline bool operator!=(const std::nullptr_t) const
 			{
-				return ptr != nullptr;
+				return index != std::numeric_limits<uint_fast32_t>::max();
 			}
 #ifdef CPPE_TESTING
 			inline uint_fast32_t get_debug_index() const
@@ -64,11 +52,111 @@ namespace cppe
 #endif
 		};
 
-		using class_t = primitive_bucket_pool<T>;
+	public:
+		static bucket_info	 info_from_index(const uint_fast32_t index);
+		static uint_fast32_t bucket_index_to_bucket_size(const uint_fast32_t index);
+		static uint_fast32_t bucket_index_to_element_index(const uint_fast32_t index);
+
+	protected:
+		// BUCKETS is the bucket array of the pool, its elements have a size member
+		template <std::size_t BUCKET_SKIP_COUNT, class BUCKETS>
+		cppedecl_finline static bucket_info index_to_valid_location(const uint_fast32_t ind, const BUCKETS& buckets)
+		{
+			auto loc = info_from_index(ind);
+			CPPE_ASSERT(BUCKET_SKIP_COUNT <= loc.bucket_index);
+			loc.bucket_index = loc.bucket_index - uint_fast32_t(BUCKET_SKIP_COUNT);
+			CPPE_ASSERT(loc.bucket_index < buckets.size() && loc.data_index < buckets[loc.bucket_index].size);
+			return loc;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// compact handle: element index in the low INDEX_BITS, slot generation in the rest.
+	// the generation of a slot changes on every release so an id kept after release no longer resolves.
+	template <class UINT, std::size_t INDEX_BITS>
+	struct pool_id
+	{
+		static_assert(std::is_unsigned<UINT>::value && INDEX_BITS < sizeof(UINT) * 8 && INDEX_BITS <= 32);
+
+	public:
+		using value_t = UINT;
+
+		static constexpr std::size_t index_bits = INDEX_BITS;
+		static constexpr std::size_t generation_bits = sizeof(UINT) * 8 - INDEX_BITS;
+		static constexpr UINT		 index_mask = (UINT(1) << INDEX_BITS) - 1;
+		static constexpr UINT		 generation_mask = UINT(~UINT(0)) >> INDEX_BITS;
+
+		UINT value = ~UINT(0);
+
+	public:
+		static constexpr pool_id make(const uint_fast32_t index, const std::uint32_t generation)
+		{
+			CPPE_ASSERT(index < index_mask); // index_mask itself is the null id
+			return pool_id { UINT(UINT(index) | (UINT(generation & generation_mask) << INDEX_BITS)) };
+		}
+		cppedecl_finline uint_fast32_t index() const
+		{
+			return uint_fast32_t(value & index_mask);
+		}
+		cppedecl_finline std::uint32_t generation() const
+		{
+			return std::uint32_t(value >> INDEX_BITS);
+		}
+
+		inline bool operator==(const std::nullptr_t) const
+		{
+			return index() == index_mask;
+		}
+		inline bool operator!=(const std::nullptr_t) const
+		{
+			return index() != index_mask;
+		}
+		inline bool operator==(const pool_id& other) const
+		{
+			return value == other.value;
+		}
+		inline bool operator!=(const pool_id& other) const
+		{
+			return value != other.value;
+		}
+	};
+
+	using pool_id32 = pool_id<std::uint32_t, 20>; // 1M objects, 4096 generations per slot
+	using pool_id64 = pool_id<std::uint64_t, 32>; // 4G objects, 4G generations per slot
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T, std::size_t BUCKET_SKIP_COUNT = 0, class ALLOCATOR = std::allocator<T>>
+	struct primitive_bucket_pool : public bucket_helper
+	{
+	public:
+		struct handle : public index_handle<BUCKET_SKIP_COUNT>
+		{
+		public:
+			T* ptr = nullptr;
+
+		public:
+			inline void reset()
+			{
+				(*this) = handle {};
+			}
+		};
+
+		using class_t = primitive_bucket_pool<T, BUCKET_SKIP_COUNT, ALLOCATOR>;
 		using handle_t = handle;
 
+		template <class U>
+		using rebind_t = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<U>;
+
 	public:
 		primitive_bucket_pool() = default;
+		explicit primitive_bucket_pool(const ALLOCATOR& alc) // buckets and free lists are allocated from alc
+			: m_free_indices(rebind_t<uint_fast32_t>(alc))
+			, m_buckets(rebind_t<bucket_info>(alc))
+			, m_address_table(rebind_t<address_entry>(alc))
+		{
+		}
 		primitive_bucket_pool(const class_t&) = delete;
 		class_t& operator=(const class_t&) = delete;
 
@@ -77,8 +165,13 @@ namespace cppe
 #ifdef CPPE_POOL_VALIDATION
 			validate_empty();
 #endif
+			destroy_objects();
 			for (auto b : m_buckets)
-				delete[] b.buffer;
+			{
+				deallocate_array(b.buffer, b.size);
+				deallocate_array(b.occupancy, occupancy_bitmap::word_count(b.size));
+				deallocate_array(b.generations, b.size);
+			}
 		}
 
 #ifdef CPPE_POOL_VALIDATION
@@ -92,17 +185,39 @@ namespace cppe
 				CPPE_ASSERT(start == m_free_indices[i]);
 				start++;
 			}
+			CPPE_ASSERT(size() == 0);
 		}
 #endif
 
+		cppedecl_finline ALLOCATOR get_allocator() const
+		{
+			return ALLOCATOR(m_buckets.get_allocator());
+		}
+
 		cppedecl_finline void swap(class_t& other)
 		{
+			CPPE_ASSERT(m_buckets.get_allocator() == other.m_buckets.get_allocator()); // pools must share the allocator
 			m_free_indices.swap(other.m_free_indices);
 			m_buckets.swap(other.m_buckets);
+			m_address_table.swap(other.m_address_table);
+		}
+
+		std::size_t size() const // live objects
+		{
+			std::size_t r = 0;
+			for (const auto& b : m_buckets)
+				r += occupancy_bitmap::popcount(b.occupancy, occupancy_bitmap::word_count(b.size));
+			return r;
+		}
+		cppedecl_finline std::size_t bucket_count() const
+		{
+			return m_buckets.size();
 		}
 
 	public:
-		handle create()
+		// buckets are raw storage, the object is constructed in place from args (default initialized without args)
+		template <class... ARGS>
+		handle create(ARGS&&... args)
 		{
 			handle h;
 
@@ -118,31 +233,83 @@ namespace cppe
 
 				auto loc = index_to_valid_location(h.index);
 				h.ptr = &m_buckets[loc.bucket_index].buffer[loc.data_index];
+				occupancy_bitmap::set(m_buckets[loc.bucket_index].occupancy, loc.data_index);
 			}
+			if constexpr (sizeof...(ARGS) == 0)
+				new (h.ptr) T;
+			else
+				new (h.ptr) T(std::forward<ARGS>(args)...);
 			return h;
 		}
 		cppedecl_finline void release(const handle& handle)
 		{
+			auto loc = index_to_valid_location(handle.index);
+			release_slot(m_buckets[loc.bucket_index], loc.data_index);
 			m_free_indices.push_back(handle.index);
 		}
 
+		// same as create() but returns a compact generational id, see resolve().
+		// returns a null id without creating anything once the next index doesn't fit in ID
+		template <class ID = pool_id64, class... ARGS>
+		ID create_id(ARGS&&... args)
+		{
+			if (next_index() >= ID::index_mask)
+				return ID {};
+			handle h = create(std::forward<ARGS>(args)...);
+			auto   loc = index_to_valid_location(h.index);
+			return ID::make(h.index, m_buckets[loc.bucket_index].generations[loc.data_index]);
+		}
+		// nullptr when the id is null or its object was released
+		template <class ID>
+		T* resolve(const ID id) const
+		{
+			if (id == nullptr)
+				return nullptr;
+			auto loc = info_from_index(id.index());
+			if (loc.bucket_index < BUCKET_SKIP_COUNT || (loc.bucket_index - BUCKET_SKIP_COUNT) >= m_buckets.size())
+				return nullptr;
+			const auto& b = m_buckets[loc.bucket_index - BUCKET_SKIP_COUNT];
+			// the generation wraps, a free slot must never resolve even if its generation matches again
+			if (!occupancy_bitmap::test(b.occupancy, loc.data_index) || (b.generations[loc.data_index] & ID::generation_mask) != id.generation())
+				return nullptr;
+			return &b.buffer[loc.data_index];
+		}
+		// returns false for stale ids
+		template <class ID>
+		bool release(const ID id) requires(!std::is_same_v<ID, handle> && !std::is_pointer_v<ID>)
+		{
+			if (resolve(id) == nullptr)
+				return false;
+			auto loc = index_to_valid_location(id.index());
+			release_slot(m_buckets[loc.bucket_index], loc.data_index);
+			m_free_indices.push_back(id.index());
+			return true;
+		}
+
 		void release(const T* pv)
 		{
-			for (std::size_t i = 0, s = m_buckets.size(); i < s; i++)
+			// branchless search in the buckets sorted by address, at most log2(32) steps
+			CPPE_ASSERT(m_address_table.size() > 0);
+			const std::uintptr_t  addr = reinterpret_cast<std::uintptr_t>(pv);
+			const address_entry* base = m_address_table.data();
+			for (std::size_t n = m_address_table.size(); n > 1;)
 			{
-				const auto& b = m_buckets[i];
-				if (b.buffer <= pv && pv < (b.buffer + b.size))
-				{
-					auto element_id = bucket_index_to_element_index(uint_fast32_t(i + BUCKET_SKIP_COUNT));
-					m_free_indices.push_back(element_id + start_end_distance(b.buffer, pv));
-					return;
-				}
+				const std::size_t half = n / 2;
+				base = (base[half].begin <= addr) ? base + half : base;
+				n -= half;
 			}
-			CPPE_ASSERT(false); // object is not part of this pool
+
+			const auto& b = m_buckets[base->bucket_index];
+			CPPE_ASSERT(b.buffer <= pv && pv < (b.buffer + b.size)); // object is not part of this pool
+			auto element_id = bucket_index_to_element_index(uint_fast32_t(base->bucket_index + BUCKET_SKIP_COUNT));
+			release_slot(b, std::size_t(pv - b.buffer));
+			m_free_indices.push_back(element_id + uint_fast32_t(pv - b.buffer));
 		}
 
-		void clear()
+		void clear() // destroys every live object
 		{
+			for (const auto& b : m_buckets)
+				occupancy_bitmap::visit(b.occupancy, occupancy_bitmap::word_count(b.size), [&](const std::size_t i) { release_slot(b, i); });
 			m_free_indices.clear();
 			for (std::size_t b = m_buckets.size(); b > 0; b--)
 			{
@@ -157,22 +324,27 @@ namespace cppe
 		template <class F>
 		void visit_objects(const F& _func)
 		{
-			std::sort(m_free_indices.begin(), m_free_indices.end(), std::greater<uint_fast32_t>());
-
-			uint_fast32_t itr = bucket_index_to_element_index(uint_fast32_t(BUCKET_SKIP_COUNT));
-			for (std::size_t i = m_free_indices.size(); i > 0; i--)
-			{
-				const auto ind = m_free_indices[i - 1];
-				while (itr < ind)
-				{
-					auto loc = index_to_valid_location(itr++);
-					_func(m_buckets[loc.bucket_index].buffer[loc.data_index]);
-				}
-				itr++;
-			}
+			// live objects in creation index order
+			for (std::size_t b = 0, s = m_buckets.size(); b < s; b++)
+				visit_bucket_objects(b, _func);
+		}
+		template <class F>
+		void visit_bucket_objects(const std::size_t bucket_index, const F& _func)
+		{
+			// buckets don't share state, different buckets can be visited from different threads
+			CPPE_ASSERT(bucket_index < m_buckets.size());
+			const auto& b = m_buckets[bucket_index];
+			occupancy_bitmap::visit(b.occupancy, occupancy_bitmap::word_count(b.size), [&](const std::size_t i) { _func(b.buffer[i]); });
 		}
 
 	protected:
+		cppedecl_finline uint_fast32_t next_index() const // index used by the next create()
+		{
+			if (m_free_indices.size() == 0)
+				return bucket_index_to_element_index(uint_fast32_t(m_buckets.size() + BUCKET_SKIP_COUNT));
+			return m_free_indices.back();
+		}
+
 		uint_fast32_t append_bucket()
 		{
 			std::size_t bucket_index = m_buckets.size();
@@ -181,9 +353,26 @@ namespace cppe
 			auto bucket_size = bucket_index_to_bucket_size(uint_fast32_t(bucket_index + BUCKET_SKIP_COUNT));
 			auto element_id = bucket_index_to_element_index(uint_fast32_t(bucket_index + BUCKET_SKIP_COUNT));
 
-			m_buckets[bucket_index].buffer = new T[bucket_size];
+			// slots are constructed by create(), untouched memory stays untouched
+			T* buffer = allocate_array<T>(bucket_size);
+			m_buckets[bucket_index].buffer = buffer;
 			m_buckets[bucket_index].size = bucket_size;
 
+			const std::size_t	   words = occupancy_bitmap::word_count(bucket_size);
+			occupancy_bitmap::word_t* occupancy = allocate_array<occupancy_bitmap::word_t>(words);
+			std::fill_n(occupancy, words, occupancy_bitmap::word_t(0));
+			occupancy_bitmap::set(occupancy, 0); // the first element is returned by create()
+			m_buckets[bucket_index].occupancy = occupancy;
+
+			std::uint32_t* generations = allocate_array<std::uint32_t>(bucket_size);
+			std::fill_n(generations, bucket_size, std::uint32_t(0));
+			m_buckets[bucket_index].generations = generations;
+
+			address_entry entry { reinterpret_cast<std::uintptr_t>(buffer), bucket_index };
+			m_address_table.insert(std::upper_bound(m_address_table.begin(), m_address_table.end(), entry, [](const address_entry& a, const address_entry& b) {
+				return a.begin < b.begin;
+			}), entry);
+
 			m_free_indices.resize(bucket_size - 1);
 			for (uint_fast32_t i = 1; i < bucket_size; i++)
 				m_free_indices[i - 1] = element_id + bucket_size - i;
@@ -191,25 +380,62 @@ namespace cppe
 			return element_id;
 		}
 
+		template <class U>
+		U* allocate_array(const std::size_t count)
+		{
+			rebind_t<U> alc(m_buckets.get_allocator());
+			return std::allocator_traits<rebind_t<U>>::allocate(alc, count);
+		}
+		template <class U>
+		void deallocate_array(U* p, const std::size_t count)
+		{
+			rebind_t<U> alc(m_buckets.get_allocator());
+			std::allocator_traits<rebind_t<U>>::deallocate(alc, p, count);
+		}
+
+		struct bucket_info;
+		cppedecl_finline static void release_slot(const bucket_info& b, const std::size_t data_index)
+		{
+			occupancy_bitmap::reset(b.occupancy, data_index);
+			b.generations[data_index]++; // invalidates ids of the released object
+			b.buffer[data_index].~T();
+		}
+
+		void destroy_objects()
+		{
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				visit_objects([](T& e) { e.~T(); });
+		}
+
 		cppedecl_finline bucket_helper::bucket_info index_to_valid_location(uint_fast32_t ind) const
 		{
-			auto loc = info_from_index(ind);
-			CPPE_ASSERT(BUCKET_SKIP_COUNT <= loc.bucket_index);
-			loc.bucket_index = loc.bucket_index - uint_fast32_t(BUCKET_SKIP_COUNT);
-			CPPE_ASSERT(loc.bucket_index < m_buckets.size() && loc.data_index < m_buckets[loc.bucket_index].size);
-			return loc;
+			return bucket_helper::index_to_valid_location<BUCKET_SKIP_COUNT>(ind, m_buckets);
 		}
 
 	protected:
 		struct bucket_info
 		{
-			T*			buffer;
-			std::size_t size;
+			T*						  buffer;
+			std::size_t				  size;
+			occupancy_bitmap::word_t* occupancy;
+			std::uint32_t*			  generations; // bumped on every release
 		};
-		std::vector<uint_fast32_t> m_free_indices;
-		std::vector<bucket_info>   m_buckets;
+		struct address_entry
+		{
+			std::uintptr_t begin;
+			std::size_t	   bucket_index;
+		};
+		std::vector<uint_fast32_t, rebind_t<uint_fast32_t>> m_free_indices;
+		std::vector<bucket_info, rebind_t<bucket_info>>		m_buckets;
+		std::vector<address_entry, rebind_t<address_entry>> m_address_table; // m_buckets sorted by address, used by release(const T*)
 	};
 
+	namespace pmr
+	{
+		template <class T, std::size_t BUCKET_SKIP_COUNT = 0>
+		using primitive_bucket_pool = cppe::primitive_bucket_pool<T, BUCKET_SKIP_COUNT, std::pmr::polymorphic_allocator<T>>;
+	}
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 
 }
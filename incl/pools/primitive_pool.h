@@ -1,24 +1,24 @@
 #pragma once
 
 #include "../config/cppelements_config.h"
-#ifdef CPPE_POOL_VALIDATION
-#	include <algorithm>
-#endif
+#include "occupancy_bitmap.h"
+#include <vector>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <limits>
 
 namespace cppe
 {
 
+	// fixed capacity pool over raw storage, objects are constructed by create() and destroyed by release()
 	template <class T>
 	struct primitive_pool
 	{
 	public:
 		primitive_pool(const std::size_t sz)
 		{
-			m_free_indices.resize(sz);
-			for (uint_fast32_t i = 0; i < sz; i++)
-				m_free_indices[i] = uint_fast32_t(sz - i - 1);
-
-			m_data.resize(sz);
+			rebuild(sz);
 		}
 
 		~primitive_pool()
@@ -30,73 +30,148 @@ namespace cppe
 			{
 				CPPE_ASSERT(i == m_free_indices[i]);
 			}
+			CPPE_ASSERT(size() == 0);
 #endif
+			destroy_objects();
 		}
 
 	public:
-		cppedecl_finline T* create()
+		template <class... ARGS>
+		cppedecl_finline T* create(ARGS&&... args)
 		{
 			if (m_free_indices.size() > 0)
 			{
 				uint_fast32_t i = m_free_indices.back();
 				m_free_indices.pop_back();
-				return &m_data[i];
+				occupancy_bitmap::set(m_occupancy.data(), i);
+				if constexpr (sizeof...(ARGS) == 0)
+					return new (element(i)) T;
+				else
+					return new (element(i)) T(std::forward<ARGS>(args)...);
 			}
 			return nullptr;
 		}
 
 		cppedecl_finline void release(const T* px)
 		{
-			auto d = start_end_distance(&m_data[0], px);
-			CPPE_ASSERT(d < m_data.size());
-			auto& element = m_data[uint_fast32_t(d)];
-			{
-				// rebuild
-				element.~T();
-				new (&element) T;
-			}
+			auto d = start_end_distance(element(0), px);
+			CPPE_ASSERT(d < m_capacity);
+			px->~T();
+			occupancy_bitmap::reset(m_occupancy.data(), std::size_t(d));
 			m_free_indices.push_back(uint_fast32_t(d));
 		}
 
 	public:
+		std::size_t size() const // live objects
+		{
+			return occupancy_bitmap::popcount(m_occupancy.data(), m_occupancy.size());
+		}
+		cppedecl_finline std::size_t capacity() const
+		{
+			return m_capacity;
+		}
+
 		template <class F>
 		void visit_objects(const F& _func)
 		{
-			std::sort(m_free_indices.begin(), m_free_indices.end(), std::greater<uint_fast32_t>());
+			// live objects in index order
+			occupancy_bitmap::visit(m_occupancy.data(), m_occupancy.size(), [&](const std::size_t i) { _func(*element(i)); });
+		}
+		void clear() // destroys every live object
+		{
+			destroy_objects();
+			m_free_indices.resize(m_capacity);
+			uint_fast32_t s = uint_fast32_t(m_capacity);
+			for (uint_fast32_t i = 0; i < s; i++)
+				m_free_indices[i] = s - i - 1;
+			std::fill(m_occupancy.begin(), m_occupancy.end(), occupancy_bitmap::word_t(0));
+		}
 
-			uint_fast32_t itr = 0;
-			for (std::size_t i = m_free_indices.size(); i > 0; i--)
+		// moves the live objects to the front of the storage, visit_objects() becomes a dense walk.
+		// _relocated(from, to) is called for every moved object, `from` is already destroyed.
+		// returns the number of live objects.
+		template <class F>
+		std::size_t compact(const F& _relocated)
+		{
+			std::size_t live = size();
+			std::size_t lo = 0;
+			std::size_t hi = m_capacity;
+			while (true)
 			{
-				const auto ind = m_free_indices[i - 1];
-				while (itr < ind)
-					_func(m_data[itr++]);
-				itr++;
+				while (lo < live && occupancy_bitmap::test(m_occupancy.data(), lo))
+					lo++;
+				if (lo == live)
+					break;
+				do
+				{
+					hi--;
+				} while (!occupancy_bitmap::test(m_occupancy.data(), hi));
+
+				relocate_n(element(hi), element(lo), 1);
+				occupancy_bitmap::reset(m_occupancy.data(), hi);
+				occupancy_bitmap::set(m_occupancy.data(), lo);
+				_relocated(element(hi), element(lo));
 			}
+
+			// free list is everything after the live objects, lowest index first
+			m_free_indices.resize(m_capacity - live);
+			for (std::size_t i = 0; i < m_free_indices.size(); i++)
+				m_free_indices[i] = uint_fast32_t(m_capacity - i - 1);
+			return live;
 		}
-		void clear()
+		// same as compact(F) but returns old index -> new index, max() for free slots
+		std::vector<uint_fast32_t> compact()
 		{
-			m_free_indices.resize(m_data.size());
-			uint_fast32_t s = uint_fast32_t(m_data.size());
-			for (uint_fast32_t i = s; i > 0; i++)
-			{
-				m_free_indices[s - i] = s - i - 1;
-			}
+			std::vector<uint_fast32_t> remap(m_capacity, std::numeric_limits<uint_fast32_t>::max());
+			occupancy_bitmap::visit(m_occupancy.data(), m_occupancy.size(), [&](const std::size_t i) { remap[i] = uint_fast32_t(i); });
+			compact([&](const T* from, const T* to) { remap[index_of(from)] = index_of(to); });
+			return remap;
+		}
+
+		cppedecl_finline uint_fast32_t index_of(const T* px) const
+		{
+			auto d = start_end_distance(element(0), px);
+			CPPE_ASSERT(d < m_capacity);
+			return d;
 		}
 
 		void rebuild(const std::size_t sz)
 		{
-			visit_objects([&](T& e) { e = T(); });
+			destroy_objects();
 
 			m_free_indices.resize(sz);
 			for (uint_fast32_t i = 0; i < sz; i++)
 				m_free_indices[i] = uint_fast32_t(sz - i - 1);
 
-			m_data.resize(sz);
+			if (sz != m_capacity)
+			{
+				m_data.reset(new slot[sz]); // default initialized, pages are touched on first use
+				m_capacity = sz;
+			}
+			m_occupancy.assign(occupancy_bitmap::word_count(sz), occupancy_bitmap::word_t(0));
+		}
+
+	protected:
+		cppedecl_finline T* element(const std::size_t index) const
+		{
+			return std::launder(reinterpret_cast<T*>(m_data[index].bytes));
+		}
+		void destroy_objects()
+		{
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				visit_objects([](T& e) { e.~T(); });
 		}
 
 	public:
-		std::vector<uint_fast32_t> m_free_indices;
-		std::vector<T>			   m_data;
+		struct slot
+		{
+			alignas(T) unsigned char bytes[sizeof(T)];
+		};
+
+		std::vector<uint_fast32_t>			  m_free_indices;
+		std::unique_ptr<slot[]>				  m_data;
+		std::size_t							  m_capacity = 0;
+		std::vector<occupancy_bitmap::word_t> m_occupancy;
 	};
 
 }
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "primitive_bucket_pool.h"
+#include <tuple>
+#include <new>
+
+namespace cppe
+{
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// structure of arrays version of primitive_bucket_pool, FIELDS is a std::tuple of the column types.
+	// every bucket stores each field in its own cache line aligned column so a loop over a few fields only reads those.
+	// handles are element indices with the same bucket layout and stay valid until released.
+	// fields are constructed by create() and destroyed by release(), free slots hold no objects.
+	template <class FIELDS, std::size_t BUCKET_SKIP_COUNT = 0, class ALLOCATOR = std::allocator<unsigned char>>
+	struct soa_bucket_pool;
+
+	template <class... TS, std::size_t BUCKET_SKIP_COUNT, class ALLOCATOR>
+	struct soa_bucket_pool<std::tuple<TS...>, BUCKET_SKIP_COUNT, ALLOCATOR> : public bucket_helper
+	{
+		static_assert(sizeof...(TS) > 0, "need at least one field");
+
+	public:
+		using class_t = soa_bucket_pool<std::tuple<TS...>, BUCKET_SKIP_COUNT, ALLOCATOR>;
+		using handle = index_handle<BUCKET_SKIP_COUNT>;
+		using handle_t = handle;
+
+		static constexpr std::size_t field_count = sizeof...(TS);
+		static constexpr std::size_t column_alignment = std::max({ std::size_t(64), alignof(TS)... });
+
+		template <std::size_t I>
+		using field_t = std::tuple_element_t<I, std::tuple<TS...>>;
+
+		template <class U>
+		using rebind_t = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<U>;
+
+	public:
+		soa_bucket_pool() = default;
+		explicit soa_bucket_pool(const ALLOCATOR& alc) // columns and free lists are allocated from alc
+			: m_free_indices(rebind_t<uint_fast32_t>(alc))
+			, m_buckets(rebind_t<bucket>(alc))
+		{
+		}
+		soa_bucket_pool(const class_t&) = delete;
+		class_t& operator=(const class_t&) = delete;
+
+		~soa_bucket_pool()
+		{
+#ifdef CPPE_POOL_VALIDATION
+			validate_empty();
+#endif
+			for (auto& b : m_buckets)
+			{
+				destroy_bucket_fields(b);
+				free_columns(b, std::index_sequence_for<TS...> {});
+				rebind_t<occupancy_bitmap::word_t> alc(m_buckets.get_allocator());
+				std::allocator_traits<rebind_t<occupancy_bitmap::word_t>>::deallocate(alc, b.occupancy, occupancy_bitmap::word_count(b.size));
+			}
+		}
+
+#ifdef CPPE_POOL_VALIDATION
+		void validate_empty()
+		{
+			// make sure everything is deallocated
+			CPPE_ASSERT(size() == 0);
+		}
+#endif
+
+		cppedecl_finline ALLOCATOR get_allocator() const
+		{
+			return ALLOCATOR(m_buckets.get_allocator());
+		}
+
+	public:
+		// constructs one field from each value, without values the fields are value initialized
+		template <class... ARGS>
+		handle create(ARGS&&... args)
+		{
+			static_assert(sizeof...(ARGS) == 0 || sizeof...(ARGS) == field_count, "pass every field or none");
+
+			handle h;
+			if (m_free_indices.size() == 0)
+				append_bucket();
+			h.index = m_free_indices.back();
+			m_free_indices.pop_back();
+
+			auto  loc = index_to_valid_location(h.index);
+			auto& b = m_buckets[loc.bucket_index];
+			occupancy_bitmap::set(b.occupancy, loc.data_index);
+			construct_fields(b, loc.data_index, std::index_sequence_for<TS...> {}, std::forward<ARGS>(args)...);
+			return h;
+		}
+		void release(const handle& h)
+		{
+			auto  loc = index_to_valid_location(h.index);
+			auto& b = m_buckets[loc.bucket_index];
+			occupancy_bitmap::reset(b.occupancy, loc.data_index);
+			destroy_fields(b, loc.data_index, std::index_sequence_for<TS...> {});
+			m_free_indices.push_back(h.index);
+		}
+
+		template <std::size_t I>
+		cppedecl_finline field_t<I>& get(const handle& h)
+		{
+			auto loc = index_to_valid_location(h.index);
+			return std::get<I>(m_buckets[loc.bucket_index].columns)[loc.data_index];
+		}
+		template <std::size_t I>
+		cppedecl_finline const field_t<I>& get(const handle& h) const
+		{
+			auto loc = index_to_valid_location(h.index);
+			return std::get<I>(m_buckets[loc.bucket_index].columns)[loc.data_index];
+		}
+
+		void clear() // destroys every live object
+		{
+			for (auto& b : m_buckets)
+			{
+				destroy_bucket_fields(b);
+				std::fill_n(b.occupancy, occupancy_bitmap::word_count(b.size), occupancy_bitmap::word_t(0));
+			}
+			m_free_indices.clear();
+			for (std::size_t b = m_buckets.size(); b > 0; b--)
+				push_free_bucket(b - 1);
+		}
+
+		std::size_t size() const // live objects
+		{
+			std::size_t r = 0;
+			for (const auto& b : m_buckets)
+				r += occupancy_bitmap::popcount(b.occupancy, occupancy_bitmap::word_count(b.size));
+			return r;
+		}
+		cppedecl_finline std::size_t bucket_count() const
+		{
+			return m_buckets.size();
+		}
+
+	public:
+		// _func(field<I>&...) for every live object, only the selected columns are read
+		template <std::size_t... I, class F>
+		void visit(const F& _func)
+		{
+			for (const auto& b : m_buckets)
+				occupancy_bitmap::visit(b.occupancy, occupancy_bitmap::word_count(b.size), [&](const std::size_t i) { _func(std::get<I>(b.columns)[i]...); });
+		}
+		// _func(count, occupancy, field<I>*...) once per bucket with the raw columns, for loops the compiler can vectorize.
+		// the columns include free slots, occupancy has one bit per slot if they must be skipped
+		template <std::size_t... I, class F>
+		void visit_columns(const F& _func)
+		{
+			static_assert((std::is_trivially_copyable<field_t<I>>::value && ...), "free slots hold no objects, raw columns need trivial fields");
+			for (const auto& b : m_buckets)
+				_func(b.size, static_cast<const occupancy_bitmap::word_t*>(b.occupancy), std::get<I>(b.columns)...);
+		}
+
+	protected:
+		struct bucket
+		{
+			std::tuple<TS*...>		  columns {};
+			std::size_t				  size = 0;
+			occupancy_bitmap::word_t* occupancy = nullptr;
+		};
+		struct alignas(column_alignment) column_block
+		{
+			unsigned char bytes[column_alignment];
+		};
+
+		void append_bucket()
+		{
+			std::size_t bucket_index = m_buckets.size();
+			m_buckets.resize(bucket_index + 1);
+
+			auto& b = m_buckets[bucket_index];
+			b.size = bucket_index_to_bucket_size(uint_fast32_t(bucket_index + BUCKET_SKIP_COUNT));
+			alloc_columns(b, std::index_sequence_for<TS...> {});
+
+			const std::size_t				   words = occupancy_bitmap::word_count(b.size);
+			rebind_t<occupancy_bitmap::word_t> alc(m_buckets.get_allocator());
+			b.occupancy = std::allocator_traits<rebind_t<occupancy_bitmap::word_t>>::allocate(alc, words);
+			std::fill_n(b.occupancy, words, occupancy_bitmap::word_t(0));
+
+			push_free_bucket(bucket_index);
+		}
+		void push_free_bucket(const std::size_t bucket_index)
+		{
+			// lowest index on top of the stack
+			auto bucket_size = bucket_index_to_bucket_size(uint_fast32_t(bucket_index + BUCKET_SKIP_COUNT));
+			auto element_id = bucket_index_to_element_index(uint_fast32_t(bucket_index + BUCKET_SKIP_COUNT));
+			m_free_indices.reserve(m_free_indices.size() + bucket_size);
+			for (uint_fast32_t i = 0; i < bucket_size; i++)
+				m_free_indices.push_back(element_id + bucket_size - i - 1);
+		}
+
+		// columns are raw storage in cache line sized blocks
+		template <class U>
+		static std::size_t column_blocks(const std::size_t count)
+		{
+			return (sizeof(U) * count + column_alignment - 1) / column_alignment;
+		}
+		template <std::size_t... I>
+		void alloc_columns(bucket& b, std::index_sequence<I...>)
+		{
+			rebind_t<column_block> alc(m_buckets.get_allocator());
+			((std::get<I>(b.columns) = reinterpret_cast<field_t<I>*>(std::allocator_traits<rebind_t<column_block>>::allocate(alc, column_blocks<field_t<I>>(b.size)))), ...);
+		}
+		template <std::size_t... I>
+		void free_columns(bucket& b, std::index_sequence<I...>)
+		{
+			rebind_t<column_block> alc(m_buckets.get_allocator());
+			(std::allocator_traits<rebind_t<column_block>>::deallocate(alc, reinterpret_cast<column_block*>(std::get<I>(b.columns)), column_blocks<field_t<I>>(b.size)), ...);
+		}
+		template <std::size_t... I, class... ARGS>
+		static void construct_fields(bucket& b, const std::size_t d, std::index_sequence<I...>, ARGS&&... args)
+		{
+			if constexpr (sizeof...(ARGS) == 0)
+				(new (&std::get<I>(b.columns)[d]) field_t<I>(), ...);
+			else
+				(new (&std::get<I>(b.columns)[d]) field_t<I>(std::forward<ARGS>(args)), ...);
+		}
+		template <std::size_t... I>
+		static void destroy_fields(bucket& b, const std::size_t d, std::index_sequence<I...>)
+		{
+			(std::destroy_at(&std::get<I>(b.columns)[d]), ...);
+		}
+		void destroy_bucket_fields(bucket& b)
+		{
+			if constexpr (!(std::is_trivially_destructible<TS>::value && ...))
+				occupancy_bitmap::visit(b.occupancy, occupancy_bitmap::word_count(b.size), [&](const std::size_t i) { destroy_fields(b, i, std::index_sequence_for<TS...> {}); });
+		}
+
+		cppedecl_finline bucket_helper::bucket_info index_to_valid_location(uint_fast32_t ind) const
+		{
+			return bucket_helper::index_to_valid_location<BUCKET_SKIP_COUNT>(ind, m_buckets);
+		}
+
+	protected:
+		std::vector<uint_fast32_t, rebind_t<uint_fast32_t>> m_free_indices;
+		std::vector<bucket, rebind_t<bucket>>				m_buckets;
+	};
+
+	namespace pmr
+	{
+		template <class FIELDS, std::size_t BUCKET_SKIP_COUNT = 0>
+		using soa_bucket_pool = cppe::soa_bucket_pool<FIELDS, BUCKET_SKIP_COUNT, std::pmr::polymorphic_allocator<unsigned char>>;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+}
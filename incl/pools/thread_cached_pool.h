@@ -0,0 +1,224 @@
+#pragma once
+
+#include "primitive_bucket_pool.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+
+namespace cppe
+{
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// fixed size allocator for objects created on one thread and released on any thread.
+	// every thread gets its own heap: slots come from a primitive_bucket_pool owned by that heap and freed slots go
+	// back to the heap free list. create() and a release() on the creating thread use no atomics, a release() from
+	// another thread pushes the slot on the owner lock-free remote queue which the owner drains in one exchange
+	// when its free list runs dry.
+	// heaps live until the pool is destroyed, so short lived threads should not create objects.
+	template <class T>
+	struct thread_cached_pool
+	{
+	public:
+		using class_t = thread_cached_pool<T>;
+
+		thread_cached_pool(const class_t&) = delete;
+		class_t& operator=(const class_t&) = delete;
+
+		thread_cached_pool()
+			: m_token(s_next_token.fetch_add(1) + 1)
+		{
+		}
+		~thread_cached_pool()
+		{
+#ifdef CPPE_POOL_VALIDATION
+			for (auto& h : m_heaps)
+				h->validate_empty();
+#endif
+		}
+
+	public:
+		template <class... ARGS>
+		T* create(ARGS&&... args)
+		{
+			heap& h = local_heap();
+			slot* s = h.local_head;
+			if (s != nullptr)
+				h.local_head = s->next;
+			else
+				s = h.refill();
+			return new (s->storage) T(std::forward<ARGS>(args)...);
+		}
+
+		void release(T* p)
+		{
+			CPPE_ASSERT(p != nullptr);
+			p->~T();
+
+			slot* s = reinterpret_cast<slot*>(p);
+			heap* h = s->owner;
+			if (h == cached_heap())
+			{
+				s->next = h->local_head;
+				h->local_head = s;
+			}
+			else
+			{
+				h->push_remote(s);
+			}
+		}
+
+		void drain() // moves slots released by other threads to the calling thread free list
+		{
+			heap& h = local_heap();
+			slot* s = h.remote_head.exchange(nullptr, std::memory_order_acquire);
+			while (s != nullptr)
+			{
+				slot* next = s->next;
+				s->next = h.local_head;
+				h.local_head = s;
+				s = next;
+			}
+		}
+
+		std::size_t thread_count() const // number of threads that created objects
+		{
+			std::lock_guard<std::mutex> _(m_lock);
+			return m_heaps.size();
+		}
+
+	protected:
+		struct heap;
+
+		struct slot
+		{
+			union
+			{
+				alignas(T) unsigned char storage[sizeof(T)];
+				slot* next;
+			};
+			heap* owner;
+		};
+
+		struct alignas(64) heap
+		{
+			std::atomic<slot*> remote_head { nullptr }; // written by other threads, keep it away from the owner data
+
+			alignas(64) slot* local_head = nullptr;
+			primitive_bucket_pool<slot> slots;
+			std::size_t					slot_count = 0;
+			std::thread::id				owner_thread;
+
+		public:
+			~heap()
+			{
+#ifdef CPPE_POOL_VALIDATION
+				// hand the free slots back to the bucket pool, its validation then catches the ones never released
+				release_free_list(local_head);
+				release_free_list(remote_head.exchange(nullptr));
+#endif
+			}
+
+			slot* refill()
+			{
+				// take everything released remotely in one go, otherwise grow
+				slot* s = remote_head.exchange(nullptr, std::memory_order_acquire);
+				if (s != nullptr)
+				{
+					local_head = s->next;
+					return s;
+				}
+				s = slots.create().ptr;
+				s->owner = this;
+				slot_count++;
+				return s;
+			}
+			void push_remote(slot* s)
+			{
+				slot* head = remote_head.load(std::memory_order_relaxed);
+				do
+				{
+					s->next = head;
+				} while (!remote_head.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+#ifdef CPPE_POOL_VALIDATION
+			void release_free_list(slot* s)
+			{
+				while (s != nullptr)
+				{
+					slot* next = s->next;
+					slots.release(s);
+					s = next;
+				}
+			}
+			void validate_empty() const
+			{
+				// make sure everything was released
+				std::size_t free_count = 0;
+				for (slot* s = local_head; s != nullptr; s = s->next)
+					free_count++;
+				for (slot* s = remote_head.load(); s != nullptr; s = s->next)
+					free_count++;
+				CPPE_ASSERT(free_count == slot_count);
+			}
+#endif
+		};
+
+		struct local_cache
+		{
+			std::uint64_t token = 0;
+			heap*		  h = nullptr;
+		};
+		static constexpr std::size_t local_cache_slots = 4;
+
+	protected:
+		cppedecl_finline heap* cached_heap() const
+		{
+			const local_cache& lc = s_local_caches[m_token % local_cache_slots];
+			return (lc.token == m_token) ? lc.h : nullptr;
+		}
+		cppedecl_finline heap& local_heap()
+		{
+			heap* h = cached_heap();
+			if (h == nullptr)
+				h = register_thread();
+			return *h;
+		}
+		heap* register_thread()
+		{
+			const auto id = std::this_thread::get_id();
+
+			std::lock_guard<std::mutex> _(m_lock);
+			heap*						h = nullptr;
+			for (auto& i : m_heaps)
+			{
+				if (i->owner_thread == id)
+					h = i.get(); // evicted from the thread cache by another pool
+			}
+			if (h == nullptr)
+			{
+				m_heaps.push_back(std::make_unique<heap>());
+				h = m_heaps.back().get();
+				h->owner_thread = id;
+			}
+
+			local_cache& lc = s_local_caches[m_token % local_cache_slots];
+			lc.token = m_token;
+			lc.h = h;
+			return h;
+		}
+
+	protected:
+		const std::uint64_t				   m_token; // identifies this pool in the thread caches
+		mutable std::mutex				   m_lock;
+		std::vector<std::unique_ptr<heap>> m_heaps;
+
+		inline static std::atomic<std::uint64_t> s_next_token { 0 };
+		inline static thread_local local_cache	 s_local_caches[local_cache_slots];
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+}
@@ -7,8 +7,17 @@
 namespace cppe
 {
 
-	struct property_map
+	template <class ALLOCATOR = std::allocator<char>>
+	struct basic_property_map
 	{
+	public:
+		using pair_t = std::pair<string_pool_handle, string_pool_handle>;
+		using table_t = vecmap<string_pool_handle, string_pool_handle, typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<pair_t>>;
+
+	public:
+		basic_property_map() = default;
+		explicit basic_property_map(const ALLOCATOR& alc); // keys, values and the lookup table are allocated from alc
+
 	public:
 		void LoadArray(const array_view<const char* const>& elements);
 		void LoadIni(std::istream& is);
@@ -45,14 +54,25 @@ namespace cppe
 		{
 			return m_data.size();
 		}
-		const std::pair<string_pool_handle, string_pool_handle>& get(const std::size_t i)
+		const pair_t& get(const std::size_t i)
 		{
 			return m_data.at(i);
 		}
 
 	protected:
-		vecmap<string_pool_handle, string_pool_handle> m_data;
-		string_pool									   m_buf;
+		table_t					   m_data;
+		basic_string_pool<ALLOCATOR> m_buf;
 	};
 
+	using property_map = basic_property_map<>;
+
+	namespace pmr
+	{
+		using property_map = cppe::basic_property_map<std::pmr::polymorphic_allocator<char>>;
+	}
+
+	// members are defined in property_map.cpp for these allocators
+	extern template struct basic_property_map<std::allocator<char>>;
+	extern template struct basic_property_map<std::pmr::polymorphic_allocator<char>>;
+
 }
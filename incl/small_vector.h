@@ -0,0 +1,344 @@
+#pragma once
+
+#include "config/cppelements_config.h"
+#include <new>
+#include <type_traits>
+
+namespace cppe
+{
+	namespace detail
+	{
+		// where small_vector spills once the inline storage is full
+		template <class ALLOCATOR>
+		struct spill_storage
+		{
+			ALLOCATOR* allocator = nullptr;
+
+			cppedecl_finline void* alloc(const std::size_t sz, const std::size_t align) const
+			{
+				return allocator->alloc(sz, align);
+			}
+			cppedecl_finline void free(void* p, const std::size_t, const std::size_t) const
+			{
+				allocator->free(p);
+			}
+			cppedecl_finline bool try_grow(void* p, const std::size_t old_size, const std::size_t new_size) const
+			{
+				if constexpr (requires(ALLOCATOR& a) { a.try_grow(p, old_size, new_size); })
+					return allocator->try_grow(p, old_size, new_size);
+				else
+					return false;
+			}
+		};
+		template <>
+		struct spill_storage<void>
+		{
+			cppedecl_finline void* alloc(const std::size_t sz, const std::size_t align) const
+			{
+				return ::operator new(sz, std::align_val_t(align));
+			}
+			cppedecl_finline void free(void* p, const std::size_t, const std::size_t align) const
+			{
+				::operator delete(p, std::align_val_t(align));
+			}
+			cppedecl_finline bool try_grow(void*, const std::size_t, const std::size_t) const
+			{
+				return false;
+			}
+		};
+	}
+
+	//------------------------------------------------------------------------------------------------------
+	// vector with room for N elements inline, then spills to the heap (ALLOCATOR = void) or to an arena like
+	// linear_allocator (anything with alloc(sz, align) and free(p); try_grow() is used when available).
+	// when the arena is full the buffer goes to the heap instead. growth of trivially relocatable types is a single memcpy.
+	template <class T, std::size_t N, class ALLOCATOR = void>
+	struct small_vector
+	{
+		static_assert(N > 0, "use a std::vector instead");
+
+	public:
+		using class_t = small_vector<T, N, ALLOCATOR>;
+		using value_type = T;
+		using iterator_t = T*;
+		using const_iterator = const T*;
+
+		static constexpr std::size_t inline_size()
+		{
+			return N;
+		}
+
+	public:
+		small_vector() requires std::is_void_v<ALLOCATOR>
+		= default;
+		template <class A = ALLOCATOR>
+		explicit small_vector(A& alc) requires(!std::is_void_v<A> && std::is_same_v<A, ALLOCATOR>)
+		{
+			m_storage.allocator = &alc;
+		}
+		small_vector(const class_t& other)
+			: m_storage(other.m_storage)
+		{
+			reserve(other.size());
+			for (std::size_t i = 0, s = other.size(); i < s; i++)
+				new (m_data + i) T(other[i]);
+			m_size = other.size();
+		}
+		small_vector(class_t&& other)
+			: m_storage(other.m_storage)
+		{
+			if (other.is_inline())
+			{
+				relocate_n(other.m_data, m_data, other.m_size);
+			}
+			else
+			{
+				m_data = other.m_data;
+				m_capacity = other.m_capacity;
+				m_on_heap = other.m_on_heap;
+				other.m_data = other.inline_data();
+				other.m_capacity = N;
+				other.m_on_heap = false;
+			}
+			m_size = other.m_size;
+			other.m_size = 0;
+		}
+		class_t& operator=(const class_t& other)
+		{
+			if (this != &other)
+			{
+				clear();
+				reserve(other.size());
+				for (std::size_t i = 0, s = other.size(); i < s; i++)
+					new (m_data + i) T(other[i]);
+				m_size = other.size();
+			}
+			return *this;
+		}
+		class_t& operator=(class_t&& other)
+		{
+			if (this != &other)
+			{
+				this->~small_vector();
+				new (this) class_t(std::move(other));
+			}
+			return *this;
+		}
+		~small_vector()
+		{
+			clear();
+			free_buffer();
+		}
+
+	public:
+		template <class... ARGS>
+		T& emplace_back(ARGS&&... args)
+		{
+			if (m_size == m_capacity)
+				return grow_and_emplace(std::forward<ARGS>(args)...);
+			T* r = new (m_data + m_size) T(std::forward<ARGS>(args)...);
+			m_size++;
+			return *r;
+		}
+		void push_back(const T& value)
+		{
+			emplace_back(value);
+		}
+		void push_back(T&& value)
+		{
+			emplace_back(std::move(value));
+		}
+		void pop_back()
+		{
+			CPPE_ASSERT(m_size > 0);
+			m_data[--m_size].~T();
+		}
+		void clear()
+		{
+			for (std::size_t i = 0; i < m_size; i++)
+				m_data[i].~T();
+			m_size = 0;
+		}
+		void reserve(const std::size_t capacity)
+		{
+			if (capacity > m_capacity)
+				relocate_to(capacity);
+		}
+		void resize(const std::size_t sz)
+		{
+			reserve(sz);
+			for (std::size_t i = m_size; i < sz; i++)
+				new (m_data + i) T();
+			for (std::size_t i = sz; i < m_size; i++)
+				m_data[i].~T();
+			m_size = sz;
+		}
+
+	public:
+		cppedecl_finline std::size_t size() const
+		{
+			return m_size;
+		}
+		cppedecl_finline std::size_t capacity() const
+		{
+			return m_capacity;
+		}
+		cppedecl_finline bool empty() const
+		{
+			return m_size == 0;
+		}
+		cppedecl_finline bool is_inline() const
+		{
+			return m_data == inline_data();
+		}
+
+		cppedecl_finline T* data()
+		{
+			return m_data;
+		}
+		cppedecl_finline const T* data() const
+		{
+			return m_data;
+		}
+		cppedecl_finline T* begin()
+		{
+			return m_data;
+		}
+		cppedecl_finline T* end()
+		{
+			return m_data + m_size;
+		}
+		cppedecl_finline const T* begin() const
+		{
+			return m_data;
+		}
+		cppedecl_finline const T* end() const
+		{
+			return m_data + m_size;
+		}
+		cppedecl_finline T& back()
+		{
+			CPPE_ASSERT(m_size > 0);
+			return m_data[m_size - 1];
+		}
+		cppedecl_finline const T& back() const
+		{
+			CPPE_ASSERT(m_size > 0);
+			return m_data[m_size - 1];
+		}
+		cppedecl_finline T& operator[](const std::size_t index)
+		{
+			CPPE_ASSERT(index < m_size);
+			return m_data[index];
+		}
+		cppedecl_finline const T& operator[](const std::size_t index) const
+		{
+			CPPE_ASSERT(index < m_size);
+			return m_data[index];
+		}
+
+	protected:
+		static inline std::size_t get_buffer_size(const std::size_t element_count)
+		{
+			return sizeof(T) * element_count;
+		}
+		enum class spill_status
+		{
+			grown_in_place,
+			moved, // p is a new block from the storage
+			failed // the arena is full
+		};
+		spill_status spill(const std::size_t capacity, T*& p)
+		{
+			// extends the arena block in place when nothing was allocated after it
+			if (!is_inline() && !m_on_heap && m_storage.try_grow(m_data, get_buffer_size(m_capacity), get_buffer_size(capacity)))
+			{
+				m_capacity = capacity;
+				return spill_status::grown_in_place;
+			}
+			p = static_cast<T*>(m_storage.alloc(get_buffer_size(capacity), alignof(T)));
+			return p != nullptr ? spill_status::moved : spill_status::failed;
+		}
+		T* grow_buffer(const std::size_t capacity, bool& on_heap)
+		{
+			// returns nullptr if the block grew in place
+			T* p = nullptr;
+			switch (spill(capacity, p))
+			{
+			case spill_status::grown_in_place:
+				return nullptr;
+			case spill_status::moved:
+				on_heap = false;
+				return p;
+			default:
+				on_heap = true;
+				return static_cast<T*>(detail::spill_storage<void> {}.alloc(get_buffer_size(capacity), alignof(T)));
+			}
+		}
+		void free_buffer()
+		{
+			if (is_inline())
+				return;
+			if (m_on_heap)
+				detail::spill_storage<void> {}.free(m_data, get_buffer_size(m_capacity), alignof(T));
+			else
+				m_storage.free(m_data, get_buffer_size(m_capacity), alignof(T));
+		}
+		void adopt(T* p, const std::size_t capacity, const bool on_heap)
+		{
+			relocate_n(m_data, p, m_size);
+			free_buffer();
+			m_data = p;
+			m_capacity = capacity;
+			m_on_heap = on_heap;
+		}
+		void relocate_to(const std::size_t capacity)
+		{
+			bool on_heap = false;
+			if (T* p = grow_buffer(capacity, on_heap))
+				adopt(p, capacity, on_heap);
+		}
+
+		template <class... ARGS>
+		T& grow_and_emplace(ARGS&&... args)
+		{
+			// the new element is constructed before the old ones move so push_back(v[i]) stays valid
+			const std::size_t capacity = m_capacity * 2;
+			bool			  on_heap = false;
+			T*				  p = grow_buffer(capacity, on_heap);
+			T*				  r;
+			if (p == nullptr)
+			{
+				r = new (m_data + m_size) T(std::forward<ARGS>(args)...);
+			}
+			else
+			{
+				r = new (p + m_size) T(std::forward<ARGS>(args)...);
+				adopt(p, capacity, on_heap);
+			}
+			m_size++;
+			return *r;
+		}
+
+		cppedecl_finline T* inline_data()
+		{
+			return reinterpret_cast<T*>(m_inline);
+		}
+		cppedecl_finline const T* inline_data() const
+		{
+			return reinterpret_cast<const T*>(m_inline);
+		}
+
+	protected:
+		T*			m_data = inline_data();
+		std::size_t m_size = 0;
+		std::size_t m_capacity = N;
+		bool		m_on_heap = false; // the arena was full when the buffer was allocated
+
+		[[no_unique_address]] detail::spill_storage<ALLOCATOR> m_storage;
+
+		alignas(T) unsigned char m_inline[sizeof(T) * N];
+	};
+
+	//------------------------------------------------------------------------------------------------------
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "string_view.h"
+#include <vector>
+#include <memory_resource>
 
 namespace cppe
 {
-	struct string_pool;
+	struct string_pool_base;
 
 	//-----------------------------------------------------------------------
 	//-----------------------------------------------------------------------
@@ -66,7 +68,7 @@ namespace cppe
 			, m_cache("")
 		{
 		}
-		string_pool_handle(const string_info& info, const string_pool& str_buffer);
+		string_pool_handle(const string_info& info, const string_pool_base& str_buffer);
 
 	public:
 		const char* get() const;
@@ -130,16 +132,18 @@ namespace cppe
 			}
 		};
 	protected:
-		friend struct string_pool;
+		friend struct string_pool_base;
+		template <class ALLOCATOR>
+		friend struct basic_string_pool;
 
-		explicit string_pool_handle(const std::size_t _ind, const std::size_t _size, const string_pool* _strbp, const char* _cache)
+		explicit string_pool_handle(const std::size_t _ind, const std::size_t _size, const string_pool_base* _strbp, const char* _cache)
 			: m_strbuf(_strbp)
 			, m_offset(_ind)
 			, m_size(_size)
 			, m_cache(_cache)
 		{
 		}
-		explicit string_pool_handle(const std::size_t _ind, const std::size_t _size, const string_pool* _strbp)
+		explicit string_pool_handle(const std::size_t _ind, const std::size_t _size, const string_pool_base* _strbp)
 			: m_strbuf(_strbp)
 			, m_offset(_ind)
 			, m_size(_size)
@@ -147,23 +151,54 @@ namespace cppe
 		}
 
 	protected:
-		const string_pool* m_strbuf = nullptr;
-		std::size_t		   m_offset = 0;
-		std::size_t		   m_size = 0;
-		const char*		   m_cache = nullptr;
+		const string_pool_base* m_strbuf = nullptr;
+		std::size_t				m_offset = 0;
+		std::size_t				m_size = 0;
+		const char*				m_cache = nullptr;
 	};
 	//------------------------------------------------------------------------------------------
 	//------------------------------------------------------------------------------------------
-	struct string_pool
+	// allocator independent part of a string pool, this is what string_pool_handle points to.
+	// m_data and m_size mirror the content of the derived pool and are refreshed after every change.
+	struct string_pool_base
 	{
 	public:
 		using string_t = string_pool_handle;
 
 	public:
-		string_pool();
-		string_pool(std::vector<char>&&);
-		string_pool(const std::vector<char>&);
-		~string_pool();
+		string_t get_first() const;
+		string_t get_next(const string_t& s) const;
+
+		const char* at(const std::size_t ind) const;
+
+		const char* get(const string_t& buf) const;
+
+		std::size_t count() const; // returns the number of strings
+		std::size_t size() const;  // returns the size of the buffer in bytes
+
+	protected:
+		const char* m_data = nullptr;
+		std::size_t m_size = 0;
+		std::size_t m_count = 0;
+	};
+	//------------------------------------------------------------------------------------------
+	template <class ALLOCATOR = std::allocator<char>>
+	struct basic_string_pool : public string_pool_base
+	{
+	public:
+		using content_t = std::vector<char, ALLOCATOR>;
+
+	public:
+		basic_string_pool();
+		explicit basic_string_pool(const ALLOCATOR& alc);
+		basic_string_pool(content_t&&);
+		basic_string_pool(const content_t&);
+		basic_string_pool(const basic_string_pool&);
+		basic_string_pool(basic_string_pool&&);
+		~basic_string_pool();
+
+		basic_string_pool& operator=(const basic_string_pool&);
+		basic_string_pool& operator=(basic_string_pool&&);
 
 		string_t begin_append();
 		void	 append(string_t& s, const char c);
@@ -180,17 +215,9 @@ namespace cppe
 		string_t insert_file(const char* abs_file_path);
 
 		string_t get_all();
-		string_t get_first() const;
-		string_t get_next(const string_t& s) const;
 
-		const char* at(const std::size_t ind) const;
-
-		const char* get(const string_t& buf) const;
-
-		std::size_t count() const; // returns the number of strings
-		std::size_t size() const;  // returns the size of the buffer in bytes
-		void		clear();	   // clears all content
-		void		swap(string_pool&);
+		void clear(); // clears all content
+		void swap(basic_string_pool&);
 
 	public:
 		const char* data() const
@@ -201,16 +228,33 @@ namespace cppe
 		{
 			return m_content.data();
 		}
-		const std::vector<char>& contents() const
+		const content_t& contents() const
 		{
 			return m_content;
 		}
 
 	protected:
-		std::vector<char> m_content;
-		std::size_t		  m_count;
+		void sync()
+		{
+			m_data = m_content.data();
+			m_size = m_content.size();
+		}
+
+	protected:
+		content_t m_content;
 	};
 
+	using string_pool = basic_string_pool<>;
+
+	namespace pmr
+	{
+		using string_pool = cppe::basic_string_pool<std::pmr::polymorphic_allocator<char>>;
+	}
+
+	// members are defined in string_pool.cpp for these allocators
+	extern template struct basic_string_pool<std::allocator<char>>;
+	extern template struct basic_string_pool<std::pmr::polymorphic_allocator<char>>;
+
 	//------------------------------------------------------------------------------------------
 
 	inline const char* string_pool_handle::get() const
@@ -240,42 +284,49 @@ namespace cppe
 		return std::string_view(get(), size());
 	}
 	//------------------------------------------------------------------------------------------
-	inline string_pool::string_t string_pool::insert(const std::string& s)
+	inline const char* string_pool_base::at(const std::size_t ind) const
 	{
-		return insert(s.c_str(), s.size());
+		CPPE_ASSERT(ind < m_size);
+		return m_data + ind;
 	}
-	inline string_pool::string_t string_pool::insert(const std::string_view& s)
+	inline const char* string_pool_base::get(const string_t& buf) const
 	{
-		return insert(s.data(), s.size());
+		return at(buf.m_offset);
 	}
-	inline string_pool::string_t string_pool::insert(const std::vector<char>& s)
+	inline std::size_t string_pool_base::count() const
 	{
-		return insert(s.data(), s.size());
+		return m_count;
 	}
-	inline string_pool::string_t string_pool::insert(const string_view& s)
+	inline std::size_t string_pool_base::size() const
 	{
-		return insert(s.c_str(), s.size());
+		return m_size;
 	}
-	inline string_pool::string_t string_pool::insert(const char* x)
+	//------------------------------------------------------------------------------------------
+	template <class ALLOCATOR>
+	inline string_pool_handle basic_string_pool<ALLOCATOR>::insert(const std::string& s)
 	{
-		CPPE_ASSERT(x != nullptr);
-		return insert(x, cppe::strutil::length(x));
+		return insert(s.c_str(), s.size());
 	}
-	inline const char* string_pool::at(const std::size_t ind) const
+	template <class ALLOCATOR>
+	inline string_pool_handle basic_string_pool<ALLOCATOR>::insert(const std::string_view& s)
 	{
-		return &m_content[ind];
+		return insert(s.data(), s.size());
 	}
-	inline const char* string_pool::get(const string_pool::string_t& buf) const
+	template <class ALLOCATOR>
+	inline string_pool_handle basic_string_pool<ALLOCATOR>::insert(const std::vector<char>& s)
 	{
-		return at(buf.m_offset);
+		return insert(s.data(), s.size());
 	}
-	inline std::size_t string_pool::count() const
+	template <class ALLOCATOR>
+	inline string_pool_handle basic_string_pool<ALLOCATOR>::insert(const string_view& s)
 	{
-		return m_count;
+		return insert(s.c_str(), s.size());
 	}
-	inline std::size_t string_pool::size() const
+	template <class ALLOCATOR>
+	inline string_pool_handle basic_string_pool<ALLOCATOR>::insert(const char* x)
 	{
-		return m_content.size();
+		CPPE_ASSERT(x != nullptr);
+		return insert(x, cppe::strutil::length(x));
 	}
 	//------------------------------------------------------------------------------------------
 }
@@ -2,25 +2,31 @@
 
 #include "config/cppelements_config.h"
 #include <algorithm>
+#include <memory_resource>
 
 namespace cppe
 {
 	//--------------------------------------------------------------------------
 	//--------------------------------------------------------------------------
-	template <typename KEY, typename VALUE>
+	template <typename KEY, typename VALUE, typename ALLOCATOR = std::allocator<std::pair<KEY, VALUE>>>
 	struct vecmap
 	{
 	public:
-		using class_type = vecmap<KEY, VALUE>;
+		using class_type = vecmap<KEY, VALUE, ALLOCATOR>;
 		using key_t = KEY;
 		using value_t = VALUE;
 		using key_value_t = std::pair<KEY, VALUE>;
-		using vector_t = std::vector<key_value_t>;
-		using iterator_t = typename std::vector<key_value_t>::iterator;
+		using allocator_t = ALLOCATOR;
+		using vector_t = std::vector<key_value_t, ALLOCATOR>;
+		using iterator_t = typename vector_t::iterator;
 
 		vecmap()
 		{
 		}
+		explicit vecmap(const ALLOCATOR& alc)
+			: m_elements(alc)
+		{
+		}
 		~vecmap()
 		{
 		}
@@ -152,22 +158,22 @@ namespace cppe
 		}
 
 	public:
-		typename std::vector<key_value_t>::const_iterator begin() const
+		typename vector_t::const_iterator begin() const
 		{
 
 			return m_elements.begin();
 		}
-		typename std::vector<key_value_t>::const_iterator end() const
+		typename vector_t::const_iterator end() const
 		{
 
 			return m_elements.end();
 		}
-		typename std::vector<key_value_t>::iterator begin()
+		typename vector_t::iterator begin()
 		{
 
 			return m_elements.begin();
 		}
-		typename std::vector<key_value_t>::iterator end()
+		typename vector_t::iterator end()
 		{
 
 			return m_elements.end();
@@ -182,20 +188,20 @@ namespace cppe
 		{
 			return m_elements[index];
 		}
-		static const key_t& key(const typename std::vector<key_value_t>::const_iterator& index)
+		static const key_t& key(const typename vector_t::const_iterator& index)
 		{
 			return index->first;
 		}
-		static const value_t& value(const typename std::vector<key_value_t>::const_iterator& index)
+		static const value_t& value(const typename vector_t::const_iterator& index)
 		{
 			return index->second;
 		}
-		static value_t& value(const typename std::vector<key_value_t>::iterator& index)
+		static value_t& value(const typename vector_t::iterator& index)
 		{
 			return index->second;
 		}
 
-		typename std::vector<key_value_t>::iterator erase(const typename std::vector<key_value_t>::iterator& i)
+		typename vector_t::iterator erase(const typename vector_t::iterator& i)
 		{
 			return m_elements.erase(i);
 		}
@@ -215,7 +221,7 @@ namespace cppe
 		void swap(class_type& tp)
 		{
 
-			m_elements.swap(tp);
+			m_elements.swap(tp.m_elements);
 		}
 		std::size_t size() const
 		{
@@ -223,9 +229,16 @@ namespace cppe
 		}
 
 	protected:
-		std::vector<key_value_t> m_elements;
+		vector_t m_elements;
 	};
 	//--------------------------------------------------------------------------
+	namespace pmr
+	{
+		// vecmap with elements allocated from a std::pmr::memory_resource (see allocators/memory_resource.h)
+		template <typename KEY, typename VALUE>
+		using vecmap = cppe::vecmap<KEY, VALUE, std::pmr::polymorphic_allocator<std::pair<KEY, VALUE>>>;
+	}
+	//--------------------------------------------------------------------------
 	//--------------------------------------------------------------------------
 	//--------------------------------------------------------------------------
 }
@@ -0,0 +1,11 @@
+
+
+def configure(cfg):
+	cfg.link("cppe.pak.py")
+
+
+def construct(ctx):
+
+	ctx.config("type","exe")
+
+	ctx.fscan("src: ../bench")
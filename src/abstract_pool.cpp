@@ -1,5 +1,6 @@
 
 #include <pools/abstract_pool.h>
+#include <atomic>
 
 namespace cppe
 {
@@ -9,6 +10,12 @@ namespace cppe
 		//empty
 	}
 
+	std::size_t detail::next_abstract_pool_size_class()
+	{
+		static std::atomic<std::size_t> s_count { 0 };
+		return s_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 
 	void AbstractEntryContainer::clear()
@@ -69,4 +76,24 @@ namespace cppe
 			entry->right = nullptr;
 		}
 	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void TypeClusteredEntryContainer::clear()
+	{
+		m_clusters.clear();
+	}
+
+	void TypeClusteredEntryContainer::add_page(cluster& c, void* m)
+	{
+		CPPE_ASSERT(c.free_slots.empty());
+		auto* p = static_cast<page_header*>(m);
+		p->owner = &c;
+		p->occupancy = 0;
+		c.pages.push_back(p);
+
+		c.free_slots.resize(page_slots);
+		for(std::size_t i = 0; i < page_slots; i++)
+			c.free_slots[i] = { p, page_slots - i - 1 };
+	}
 }
\ No newline at end of file
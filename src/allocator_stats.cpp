@@ -0,0 +1,103 @@
+
+#include <allocators/allocator_stats.h>
+#include <bit>
+#include <algorithm>
+
+namespace cppe
+{
+	std::size_t allocator_stats::histogram_bucket(const std::size_t sz)
+	{
+		return std::min(std::size_t(std::bit_width(sz)), histogram_size - 1);
+	}
+
+	allocator_stats& allocator_stats::operator+=(const allocator_stats& other)
+	{
+		alloc_count += other.alloc_count;
+		alloc_bytes += other.alloc_bytes;
+		free_count += other.free_count;
+		failed_count += other.failed_count;
+		in_use += other.in_use;
+		peak_in_use += other.peak_in_use;
+		overflow_count += other.overflow_count;
+		overflow_bytes += other.overflow_bytes;
+		for (std::size_t i = 0; i < histogram_size; i++)
+			size_histogram[i] += other.size_histogram[i];
+		return *this;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+#ifdef CPPE_ALLOCATOR_STATS
+
+	namespace detail
+	{
+		void allocator_stats_recorder::record_alloc(const std::size_t requested, const std::size_t consumed)
+		{
+			m_alloc_count.fetch_add(1, std::memory_order_relaxed);
+			m_alloc_bytes.fetch_add(requested, std::memory_order_relaxed);
+			m_histogram[allocator_stats::histogram_bucket(requested)].fetch_add(1, std::memory_order_relaxed);
+
+			update_peak(m_in_use.fetch_add(consumed, std::memory_order_relaxed) + consumed);
+		}
+		void allocator_stats_recorder::record_resize(const std::size_t old_consumed, const std::size_t new_consumed)
+		{
+			if (new_consumed >= old_consumed)
+			{
+				const std::size_t grown = new_consumed - old_consumed;
+				m_alloc_bytes.fetch_add(grown, std::memory_order_relaxed);
+				update_peak(m_in_use.fetch_add(grown, std::memory_order_relaxed) + grown);
+			}
+			else
+			{
+				m_in_use.fetch_sub(old_consumed - new_consumed, std::memory_order_relaxed);
+			}
+		}
+		void allocator_stats_recorder::update_peak(const std::size_t in_use)
+		{
+			std::size_t peak = m_peak_in_use.load(std::memory_order_relaxed);
+			while (peak < in_use && !m_peak_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+			{
+			}
+		}
+		void allocator_stats_recorder::record_failed()
+		{
+			m_failed_count.fetch_add(1, std::memory_order_relaxed);
+		}
+		void allocator_stats_recorder::record_free(const std::size_t consumed)
+		{
+			m_free_count.fetch_add(1, std::memory_order_relaxed);
+			m_in_use.fetch_sub(consumed, std::memory_order_relaxed);
+		}
+		void allocator_stats_recorder::record_clear()
+		{
+			m_in_use.store(0, std::memory_order_relaxed);
+		}
+
+		allocator_stats allocator_stats_recorder::snapshot() const
+		{
+			allocator_stats r;
+			r.alloc_count = m_alloc_count.load(std::memory_order_relaxed);
+			r.alloc_bytes = m_alloc_bytes.load(std::memory_order_relaxed);
+			r.free_count = m_free_count.load(std::memory_order_relaxed);
+			r.failed_count = m_failed_count.load(std::memory_order_relaxed);
+			r.in_use = m_in_use.load(std::memory_order_relaxed);
+			r.peak_in_use = m_peak_in_use.load(std::memory_order_relaxed);
+			for (std::size_t i = 0; i < allocator_stats::histogram_size; i++)
+				r.size_histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+			return r;
+		}
+		void allocator_stats_recorder::reset()
+		{
+			m_alloc_count.store(0, std::memory_order_relaxed);
+			m_alloc_bytes.store(0, std::memory_order_relaxed);
+			m_free_count.store(0, std::memory_order_relaxed);
+			m_failed_count.store(0, std::memory_order_relaxed);
+			m_peak_in_use.store(m_in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			for (auto& h : m_histogram)
+				h.store(0, std::memory_order_relaxed);
+		}
+	}
+
+#endif
+
+}
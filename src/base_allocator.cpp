@@ -1,76 +1,175 @@
 
 
 #include <allocators/base_allocator.h>
+#include <bit>
+#include <atomic>
+#include <new>
+#include <algorithm>
 
 namespace cppe
 {
+	static_assert((overflow_allocator::min_size_class_bytes << (overflow_allocator::size_class_count - 1)) == overflow_allocator::max_size_class_bytes);
+
 	overflow_allocator::~overflow_allocator()
 	{
 		for (const auto& kv : m_allocations)
-			delete[](kv.ptr);
+			free_block(const_cast<detail::byte_t*>(kv.first), kv.second);
+		trim();
 	}
 
 	void overflow_allocator::clear()
 	{
 		for (const auto& kv : m_allocations)
-			delete[](kv.ptr);
+			recycle(const_cast<detail::byte_t*>(kv.first), kv.second);
 
 		m_allocations.clear();
+		m_size = 0;
+		m_stats.record_clear();
+	}
+
+	void overflow_allocator::trim()
+	{
+		for (std::size_t sc = 0; sc < size_class_count; sc++)
+		{
+			auto& blocks = m_free_blocks[sc];
+			for (auto* b : blocks)
+				free_block(b, size_class_bytes(sc));
+			blocks.clear();
+			blocks.shrink_to_fit();
+		}
 	}
 
 	void* overflow_allocator::alloc(const std::size_t sz)
 	{
-		detail::byte_t* r = new detail::byte_t[sz];
-		m_allocations.insert({ r, sz });
+		void* r = alloc_recycled(sz);
+		if (r == nullptr)
+		{
+			detail::byte_t* b = alloc_block(sz);
+			adopt(b, sz);
+			r = b;
+		}
 		return r;
 	}
 
-	void overflow_allocator::free(const void* p)
+	void* overflow_allocator::alloc(const std::size_t sz, const std::size_t align)
 	{
-		const detail::byte_t* bp = static_cast<const detail::byte_t*>(p);
-		auto				  itr = m_allocations.find({ bp, 0 });
+		CPPE_ASSERT(detail::is_power_of_two(align) && align <= max_alignment);
+		// size class blocks are aligned to their size, so asking for at least `align` bytes is enough
+		return alloc(std::max(sz, align));
+	}
 
-		CPPE_ASSERT(itr != m_allocations.end());
+	void* overflow_allocator::alloc_recycled(const std::size_t sz)
+	{
+		detail::byte_t* r = pop_recycled(sz);
+		if (r != nullptr)
+			adopt(r, sz);
+		return r;
+	}
+	detail::byte_t* overflow_allocator::pop_recycled(const std::size_t sz)
+	{
+		std::size_t sc = size_class(sz);
+		if (sc == size_class_count || m_free_blocks[sc].size() == 0)
+			return nullptr;
 
-		m_allocations.erase(itr);
+		detail::byte_t* r = m_free_blocks[sc].back();
+		m_free_blocks[sc].pop_back();
+		return r;
+	}
+
+	detail::byte_t* overflow_allocator::alloc_block(const std::size_t sz)
+	{
+		std::size_t sc = size_class(sz);
+		std::size_t bytes = (sc < size_class_count) ? size_class_bytes(sc) : sz;
+		return static_cast<detail::byte_t*>(::operator new(bytes, std::align_val_t(block_alignment(sc))));
+	}
+	void overflow_allocator::free_block(detail::byte_t* p, const std::size_t sz)
+	{
+		::operator delete(p, std::align_val_t(block_alignment(size_class(sz))));
+	}
+
+	void overflow_allocator::adopt(detail::byte_t* p, const std::size_t sz)
+	{
+		m_allocations.emplace(p, sz);
+		m_size += sz;
+		m_stats.record_alloc(sz, sz);
+	}
+
+	void overflow_allocator::free(const void* p)
+	{
+		bool freed = try_free(p);
+		CPPE_ASSERT(freed);
 	}
 
 	bool overflow_allocator::try_free(const void* p)
 	{
-		const detail::byte_t* bp = static_cast<const detail::byte_t*>(p);
-		auto				  itr = m_allocations.find({ bp, 0 });
-		if (itr != m_allocations.end())
-		{
-			m_allocations.erase(itr);
-			return true;
-		}
-		else
-		{
+		std::size_t sz;
+		if (!untrack(p, sz))
 			return false;
-		}
+		recycle(static_cast<detail::byte_t*>(const_cast<void*>(p)), sz);
+		return true;
+	}
+	bool overflow_allocator::untrack(const void* p, std::size_t& sz)
+	{
+		auto itr = m_allocations.find(static_cast<const detail::byte_t*>(p));
+		if (itr == m_allocations.end())
+			return false;
+		sz = itr->second;
+		m_size -= sz;
+		m_stats.record_free(sz);
+		m_allocations.erase(itr);
+		return true;
 	}
 
 	bool overflow_allocator::owns(const void* p) const
 	{
-		for (const auto& kv : m_allocations)
-		{
-			if (kv.ptr <= p && p < (kv.ptr + kv.size))
-				return true;
-		}
-		return false;
+		const detail::byte_t* bp = static_cast<const detail::byte_t*>(p);
+		auto				  itr = m_allocations.upper_bound(bp);
+		if (itr == m_allocations.begin())
+			return false;
+		--itr;
+		return bp < (itr->first + itr->second);
 	}
 
 	std::size_t overflow_allocator::size() const
 	{
-		std::size_t r = 0;
-		for (const auto& kv : m_allocations)
-			r += kv.size;
-		return r;
+		return m_size;
 	}
 
 	void overflow_allocator::swap(overflow_allocator& other)
 	{
 		m_allocations.swap(other.m_allocations);
+		std::swap(m_size, other.m_size);
+		for (std::size_t i = 0; i < size_class_count; i++)
+			m_free_blocks[i].swap(other.m_free_blocks[i]);
+	}
+
+	std::size_t overflow_allocator::size_class(const std::size_t sz)
+	{
+		if (sz > max_size_class_bytes)
+			return size_class_count;
+		if (sz <= min_size_class_bytes)
+			return 0;
+		// index of the smallest power of two >= sz, relative to min_size_class_bytes
+		return std::size_t(std::bit_width(sz - 1)) - std::size_t(std::bit_width(min_size_class_bytes - 1));
+	}
+	std::size_t overflow_allocator::size_class_bytes(const std::size_t sc)
+	{
+		return min_size_class_bytes << sc;
+	}
+	std::size_t overflow_allocator::block_alignment(const std::size_t sc)
+	{
+		if (sc < size_class_count)
+			return std::min(size_class_bytes(sc), max_alignment);
+		return max_alignment;
+	}
+
+	void overflow_allocator::recycle(detail::byte_t* ptr, const std::size_t sz)
+	{
+		std::size_t sc = size_class(sz);
+		if (sc < size_class_count)
+			m_free_blocks[sc].push_back(ptr);
+		else
+			free_block(ptr, sz);
 	}
 
 	//-------------------------------------------------------------------------------------------------------------
@@ -88,12 +187,22 @@ namespace cppe
 		std::lock_guard<std::mutex> _(m_lock);
 		m_base.clear();
 	}
+	void threaded_overflow_allocator::trim()
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		m_base.trim();
+	}
 
 	void* threaded_overflow_allocator::alloc(const std::size_t sz)
 	{
 		std::lock_guard<std::mutex> _(m_lock);
 		return m_base.alloc(sz);
 	}
+	void* threaded_overflow_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		return m_base.alloc(sz, align);
+	}
 	void threaded_overflow_allocator::free(const void* p)
 	{
 		std::lock_guard<std::mutex> _(m_lock);
@@ -104,16 +213,141 @@ namespace cppe
 		std::lock_guard<std::mutex> _(m_lock);
 		return m_base.try_free(p);
 	}
-	std::size_t threaded_overflow_allocator::size()
+	std::size_t threaded_overflow_allocator::size() const
 	{
 		std::lock_guard<std::mutex> _(m_lock);
 		return m_base.size();
 	}
-	bool threaded_overflow_allocator::owns(const void* p)
+	bool threaded_overflow_allocator::owns(const void* p) const
 	{
 		std::lock_guard<std::mutex> _(m_lock);
 		return m_base.owns(p);
 	}
+	allocator_stats threaded_overflow_allocator::stats() const
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		return m_base.stats();
+	}
+	void threaded_overflow_allocator::reset_stats()
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		m_base.reset_stats();
+	}
+	//-------------------------------------------------------------------------------------------------------------
+
+	static std::atomic<std::size_t> g_overflow_shard_counter { 0 };
+
+	std::size_t sharded_overflow_allocator::home_shard_index()
+	{
+		static thread_local std::size_t index = g_overflow_shard_counter.fetch_add(1) % shard_count;
+		return index;
+	}
+	std::size_t sharded_overflow_allocator::address_shard_index(const void* p)
+	{
+		// fibonacci hashing, blocks are at least 16 bytes apart
+		std::uint64_t h = (std::uint64_t(reinterpret_cast<std::uintptr_t>(p)) >> 4) * 0x9E3779B97F4A7C15ull;
+		return std::size_t(h >> 32) & (shard_count - 1);
+	}
+
+	void sharded_overflow_allocator::clear()
+	{
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			s.base.clear();
+		}
+	}
+	void sharded_overflow_allocator::trim()
+	{
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			s.base.trim();
+		}
+	}
+
+	void* sharded_overflow_allocator::alloc(const std::size_t sz)
+	{
+		// live blocks are tracked by the shard of their address, free lists by the home shard of the thread that
+		// freed them, so a block freed anywhere is reused by the next allocation of that thread
+		shard&			home = m_shards[home_shard_index()];
+		detail::byte_t* r;
+		{
+			std::lock_guard<std::mutex> _(home.lock);
+			r = home.base.pop_recycled(sz);
+		}
+		if (r == nullptr)
+			r = overflow_allocator::alloc_block(sz);
+
+		shard&						owner = m_shards[address_shard_index(r)];
+		std::lock_guard<std::mutex> _(owner.lock);
+		owner.base.adopt(r, sz);
+		return r;
+	}
+	void* sharded_overflow_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		CPPE_ASSERT(detail::is_power_of_two(align) && align <= overflow_allocator::max_alignment);
+		return alloc(std::max(sz, align));
+	}
+	void sharded_overflow_allocator::free(const void* p)
+	{
+		bool freed = try_free(p);
+		CPPE_ASSERT(freed);
+	}
+	bool sharded_overflow_allocator::try_free(const void* p)
+	{
+		std::size_t sz;
+		{
+			shard&						owner = m_shards[address_shard_index(p)];
+			std::lock_guard<std::mutex> _(owner.lock);
+			if (!owner.base.untrack(p, sz))
+				return false;
+		}
+		shard&						home = m_shards[home_shard_index()];
+		std::lock_guard<std::mutex> _(home.lock);
+		home.base.recycle(static_cast<detail::byte_t*>(const_cast<void*>(p)), sz);
+		return true;
+	}
+	std::size_t sharded_overflow_allocator::size() const
+	{
+		std::size_t r = 0;
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			r += s.base.size();
+		}
+		return r;
+	}
+	bool sharded_overflow_allocator::owns(const void* p) const
+	{
+		// p can point inside a block so the address hash can't be used here
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			if (s.base.owns(p))
+				return true;
+		}
+		return false;
+	}
+	allocator_stats sharded_overflow_allocator::stats() const
+	{
+		allocator_stats r;
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			r += s.base.stats();
+		}
+		return r;
+	}
+	void sharded_overflow_allocator::reset_stats()
+	{
+		for (auto& s : m_shards)
+		{
+			std::lock_guard<std::mutex> _(s.lock);
+			s.base.reset_stats();
+		}
+	}
+
 	//-------------------------------------------------------------------------------------------------------------
 
-}
+}
\ No newline at end of file
@@ -1,7 +1,7 @@
 
 #include <config/cppelements_config.h>
 
-#ifdef CPPE_ASSERT_ENABLED
+#if defined(CPPE_ENABLE_ASSERT) && !defined(CPPE_TESTING) && !defined(CPPE_DEV_PLATFORM)
 #	include <iostream>
 #	include <cassert>
 #endif
@@ -9,7 +9,7 @@
 namespace cppe
 {
 
-#ifdef CPPE_ASSERT_ENABLED
+#if defined(CPPE_ENABLE_ASSERT) && !defined(CPPE_TESTING) && !defined(CPPE_DEV_PLATFORM)
 	void cppe_assert_failed(const char* file, const int line, const char* cond)
 	{
 		std::cerr << "CPPE_ASSERT failed in " << file << "(" << line << ")> " << cond << std::endl;
@@ -5,10 +5,15 @@
 namespace cppe
 {
 
-	void linear_allocator::set_capacity(const std::size_t size)
+	bool linear_allocator::set_capacity(const std::size_t size)
 	{
-		CPPE_ASSERT(m_itr == 0);
-		m_storage.resize(size);
+		CPPE_ASSERT(m_itr == 0 || (m_storage.is_virtual() && size >= m_itr));
+		return m_storage.resize(size);
+	}
+	bool linear_allocator::reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages)
+	{
+		CPPE_ASSERT(m_itr == 0 && m_storage.size() == 0);
+		return m_storage.reserve_virtual(max_capacity, huge_pages);
 	}
 	std::size_t linear_allocator::capacity() const
 	{
@@ -17,10 +22,12 @@ namespace cppe
 	void linear_allocator::clear()
 	{
 		m_itr = 0;
+		m_stats.record_clear();
 	}
 	void linear_allocator::clear_and_resize_extra(const std::size_t sz)
 	{
 		m_itr = 0;
+		m_stats.record_clear();
 		m_storage.resize(m_storage.size() + sz);
 	}
 
@@ -34,52 +41,393 @@ namespace cppe
 
 	void* linear_allocator::alloc(const std::size_t sz)
 	{
-		std::size_t itr = m_itr + sz;
-		if ((itr + sz) <= m_storage.size())
+		return alloc(sz, 1);
+	}
+	void* linear_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		detail::byte_t*	  base = m_storage.data();
+		const std::size_t start = std::size_t(detail::align_pointer(base + m_itr, align) - base);
+		if ((start + sz) <= m_storage.size())
 		{
-			m_itr = itr;
-			return &m_storage[itr];
+			m_stats.record_alloc(sz, start + sz - m_itr);
+			m_itr = start + sz;
+			return base + start;
 		}
+		m_stats.record_failed();
 		return nullptr;
 	}
+	void* linear_allocator::alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align)
+	{
+		std::size_t bytes;
+		if (detail::batch_size(count, elem_size, align, bytes))
+			return alloc(bytes, align);
+		m_stats.record_failed();
+		return nullptr;
+	}
+
+	bool linear_allocator::try_grow(void* ptr, const std::size_t old_size, const std::size_t new_size)
+	{
+		// foreign blocks (e.g. moved to an overflow allocator) can't grow here, an empty block at the end can
+		detail::byte_t* base = m_storage.data();
+		if (!owns(ptr) && static_cast<detail::byte_t*>(ptr) != (base + m_itr))
+			return false;
+		const std::size_t start = std::size_t(static_cast<detail::byte_t*>(ptr) - base);
+		if ((start + old_size) != m_itr || new_size > (m_storage.size() - start))
+			return false;
+		m_stats.record_resize(old_size, new_size);
+		m_itr = start + new_size;
+		return true;
+	}
+	void* linear_allocator::realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align)
+	{
+		if (ptr == nullptr)
+			return alloc(new_size, align);
+		if (try_grow(ptr, old_size, new_size))
+			return ptr;
+		void* r = alloc(new_size, align);
+		if (r != nullptr)
+			std::memcpy(r, ptr, std::min(old_size, new_size));
+		return r;
+	}
 
 	//--------------------------------------------------------------------------------------------------------------------------------
 
-	void threaded_linear_allocator::set_capacity(const std::size_t size)
+	bool threaded_linear_allocator::set_capacity(const std::size_t size)
+	{
+		// in virtual mode the buffer never moves, alloc() sees the new end once m_capacity is published
+		CPPE_ASSERT(m_itr.load() == 0 || (m_storage.is_virtual() && size >= this->size()));
+		const bool resized = m_storage.resize(size);
+		m_capacity.store(m_storage.size(), std::memory_order_release);
+		return resized;
+	}
+	bool threaded_linear_allocator::reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages)
 	{
-		CPPE_ASSERT(m_itr.load() == 0);
-		m_storage.resize(size);
+		CPPE_ASSERT(m_itr.load() == 0 && m_storage.size() == 0);
+		return m_storage.reserve_virtual(max_capacity, huge_pages);
 	}
 	std::size_t threaded_linear_allocator::capacity() const
 	{
-		return m_storage.size();
+		return m_capacity.load(std::memory_order_acquire);
 	}
 	void threaded_linear_allocator::clear()
 	{
 		m_itr.store(0);
+		m_stats.record_clear();
 	}
 	void threaded_linear_allocator::clear_and_resize_extra(const std::size_t sz)
 	{
 		m_itr.store(0);
+		m_stats.record_clear();
 		m_storage.resize(m_storage.size() + sz);
+		m_capacity.store(m_storage.size(), std::memory_order_release);
 	}
 
 	bool threaded_linear_allocator::owns(const void* mem) const
 	{
-		if (m_storage.size() == 0)
-			return false;
 		const detail::byte_t* bm = static_cast<const detail::byte_t*>(mem);
-		return bm >= &m_storage[0] && bm <= &m_storage.back();
+		return bm >= m_storage.data() && bm < (m_storage.data() + capacity());
 	}
 
 	void* threaded_linear_allocator::alloc(const std::size_t sz)
+	{
+		void* r = reserve(sz);
+		if (r != nullptr)
+			m_stats.record_alloc(sz, sz);
+		else
+			m_stats.record_failed();
+		return r;
+	}
+	void* threaded_linear_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		const std::size_t padded = sz + align - 1;
+		std::size_t		  itr = m_itr.fetch_add(padded);
+		if ((itr + padded) <= capacity())
+		{
+			m_stats.record_alloc(sz, padded);
+			return detail::align_pointer(m_storage.data() + itr, align);
+		}
+		m_stats.record_failed();
+		return nullptr;
+	}
+	void* threaded_linear_allocator::alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align)
+	{
+		// one fetch_add for the whole batch instead of one per element
+		std::size_t bytes;
+		if (detail::batch_size(count, elem_size, align, bytes))
+			return alloc(bytes, align);
+		m_stats.record_failed();
+		return nullptr;
+	}
+	bool threaded_linear_allocator::try_grow(void* ptr, const std::size_t old_size, const std::size_t new_size)
+	{
+		if (!owns(ptr))
+			return false;
+		const std::size_t start = std::size_t(static_cast<detail::byte_t*>(ptr) - m_storage.data());
+		if (new_size > (capacity() - start))
+			return false;
+
+		// fails if any allocation (or a failed one) moved the end since ptr was allocated
+		std::size_t expected = start + old_size;
+		if (!m_itr.compare_exchange_strong(expected, start + new_size, std::memory_order_relaxed))
+			return false;
+		m_stats.record_resize(old_size, new_size);
+		return true;
+	}
+	void* threaded_linear_allocator::realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align)
+	{
+		if (ptr == nullptr)
+			return alloc(new_size, align);
+		if (try_grow(ptr, old_size, new_size))
+			return ptr;
+		void* r = alloc(new_size, align);
+		if (r != nullptr)
+			std::memcpy(r, ptr, std::min(old_size, new_size));
+		return r;
+	}
+	void* threaded_linear_allocator::reserve(const std::size_t sz)
 	{
 		std::size_t itr = m_itr.fetch_add(sz);
-		if ((itr + sz) <= m_storage.size())
-			return &m_storage[itr];
+		if ((itr + sz) <= capacity())
+			return m_storage.data() + itr;
 		return nullptr;
 	}
 
 	//--------------------------------------------------------------------------------------------------------------------------------
 
-}
+	static std::atomic<std::uint64_t> g_thread_cache_token { 0 };
+
+	thread_local thread_cached_linear_allocator::local_cache thread_cached_linear_allocator::s_local_caches[thread_cached_linear_allocator::local_cache_slots];
+	thread_local std::size_t								 thread_cached_linear_allocator::s_next_slot = 0;
+
+	thread_cached_linear_allocator::thread_cached_linear_allocator()
+	{
+		renew_token();
+	}
+	thread_cached_linear_allocator::thread_cached_linear_allocator(const std::size_t block_size)
+		: m_block_size(block_size)
+	{
+		renew_token();
+	}
+
+	void thread_cached_linear_allocator::set_block_size(const std::size_t size)
+	{
+		CPPE_ASSERT(size > 0);
+		m_block_size = size;
+		renew_token();
+	}
+	std::size_t thread_cached_linear_allocator::block_size() const
+	{
+		return m_block_size;
+	}
+
+	void thread_cached_linear_allocator::clear()
+	{
+		threaded_linear_allocator::clear();
+		renew_token();
+	}
+	void thread_cached_linear_allocator::clear_and_resize_extra(const std::size_t sz)
+	{
+		threaded_linear_allocator::clear_and_resize_extra(sz);
+		renew_token();
+	}
+
+	void* thread_cached_linear_allocator::realloc(void* ptr, const std::size_t old_size, const std::size_t new_size, const std::size_t align)
+	{
+		if (ptr == nullptr)
+			return alloc(new_size, align);
+		if (try_grow(ptr, old_size, new_size))
+			return ptr;
+		void* r = alloc(new_size, align);
+		if (r != nullptr)
+			std::memcpy(r, ptr, std::min(old_size, new_size));
+		return r;
+	}
+
+	void* thread_cached_linear_allocator::alloc_slow(local_cache* lc, const std::uint64_t token, const std::size_t sz, const std::size_t align)
+	{
+		const std::size_t padded = sz + align - 1;
+		if (padded > (m_block_size / 4))
+			return threaded_linear_allocator::alloc(sz, align);
+
+		// near the end of the buffer take whatever is left instead of failing on a full block
+		const std::size_t used = m_itr.load(std::memory_order_relaxed);
+		const std::size_t capacity = this->capacity();
+		const std::size_t remaining = (used < capacity) ? (capacity - used) : 0;
+		const std::size_t block_size = std::min(m_block_size, remaining);
+		if (block_size < padded)
+		{
+			m_stats.record_failed();
+			return nullptr;
+		}
+
+		auto* block = static_cast<detail::byte_t*>(reserve(block_size));
+		if (block == nullptr)
+		{
+			m_stats.record_failed();
+			return nullptr;
+		}
+
+		detail::byte_t* r = detail::align_pointer(block, align);
+		m_stats.record_alloc(sz, std::size_t(r + sz - block));
+		if (lc == nullptr) // first block of this allocator on the thread, take the next slot round robin
+			lc = &s_local_caches[s_next_slot++ % local_cache_slots];
+		lc->token = token;
+		lc->itr = r + sz;
+		lc->end = block + block_size;
+		return r;
+	}
+
+	void thread_cached_linear_allocator::renew_token()
+	{
+		m_token.store(g_thread_cache_token.fetch_add(1) + 1);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	threaded_chunked_linear_allocator::threaded_chunked_linear_allocator(const std::size_t chunk_size)
+		: m_chunk_size(chunk_size)
+	{
+	}
+	threaded_chunked_linear_allocator::~threaded_chunked_linear_allocator()
+	{
+		chunk* c = m_first.load();
+		while (c != nullptr)
+		{
+			chunk* next = c->next.load();
+			destroy_chunk(c);
+			c = next;
+		}
+	}
+
+	void threaded_chunked_linear_allocator::set_chunk_size(const std::size_t size)
+	{
+		CPPE_ASSERT(size > 0);
+		m_chunk_size = size;
+	}
+	std::size_t threaded_chunked_linear_allocator::chunk_size() const
+	{
+		return m_chunk_size;
+	}
+	std::size_t threaded_chunked_linear_allocator::capacity() const
+	{
+		std::size_t r = 0;
+		for (const chunk* c = m_first.load(); c != nullptr; c = c->next.load())
+			r += c->capacity;
+		return r;
+	}
+	std::size_t threaded_chunked_linear_allocator::size() const
+	{
+		std::size_t r = 0;
+		for (const chunk* c = m_first.load(); c != nullptr; c = c->next.load())
+			r += std::min(c->itr.load(), c->capacity);
+		return r;
+	}
+
+	void threaded_chunked_linear_allocator::clear()
+	{
+		chunk* first = m_first.load();
+		for (chunk* c = first; c != nullptr; c = c->next.load())
+			c->itr.store(0);
+		m_current.store(first);
+		m_stats.record_clear();
+	}
+	void threaded_chunked_linear_allocator::clear_and_resize_extra(const std::size_t sz)
+	{
+		clear();
+		if (sz == 0)
+			return;
+
+		std::atomic<chunk*>* link = &m_first;
+		while (chunk* c = link->load())
+			link = &c->next;
+		link->store(create_chunk(std::max(sz, m_chunk_size)));
+
+		if (m_current.load() == nullptr)
+			m_current.store(m_first.load());
+	}
+
+	bool threaded_chunked_linear_allocator::owns(const void* mem) const
+	{
+		const detail::byte_t* bm = static_cast<const detail::byte_t*>(mem);
+		for (const chunk* c = m_first.load(); c != nullptr; c = c->next.load())
+		{
+			if (bm >= c->data() && bm < (c->data() + c->capacity))
+				return true;
+		}
+		return false;
+	}
+
+	void* threaded_chunked_linear_allocator::alloc(const std::size_t sz)
+	{
+		chunk* c = m_current.load(std::memory_order_acquire);
+		while (true)
+		{
+			if (c != nullptr)
+			{
+				std::size_t itr = c->itr.fetch_add(sz, std::memory_order_relaxed);
+				if ((itr + sz) <= c->capacity)
+				{
+					m_stats.record_alloc(sz, sz);
+					return c->data() + itr;
+				}
+			}
+			c = next_chunk(c, sz);
+		}
+	}
+	void* threaded_chunked_linear_allocator::alloc(const std::size_t sz, const std::size_t align)
+	{
+		const std::size_t padded = sz + align - 1;
+		chunk*			  c = m_current.load(std::memory_order_acquire);
+		while (true)
+		{
+			if (c != nullptr)
+			{
+				std::size_t itr = c->itr.fetch_add(padded, std::memory_order_relaxed);
+				if ((itr + padded) <= c->capacity)
+				{
+					m_stats.record_alloc(sz, padded);
+					return detail::align_pointer(c->data() + itr, align);
+				}
+			}
+			c = next_chunk(c, padded);
+		}
+	}
+
+	threaded_chunked_linear_allocator::chunk* threaded_chunked_linear_allocator::next_chunk(chunk* c, const std::size_t sz)
+	{
+		// chunks are never unlinked while allocating so the chain only grows and there is no ABA problem
+		std::atomic<chunk*>& link = (c == nullptr) ? m_first : c->next;
+
+		chunk* n = link.load(std::memory_order_acquire);
+		if (n == nullptr)
+		{
+			chunk* created = create_chunk(std::max(sz, m_chunk_size));
+			if (link.compare_exchange_strong(n, created, std::memory_order_acq_rel))
+				n = created;
+			else
+				destroy_chunk(created); // another thread appended first, n is the winner
+		}
+
+		// if the CAS fails the current chunk was already moved forward by another thread
+		chunk* expected = c;
+		if (m_current.compare_exchange_strong(expected, n, std::memory_order_acq_rel))
+			return n;
+		return expected;
+	}
+
+	threaded_chunked_linear_allocator::chunk* threaded_chunked_linear_allocator::create_chunk(const std::size_t sz)
+	{
+		detail::byte_t* mem = new detail::byte_t[sizeof(chunk) + sz];
+		chunk*			c = new (mem) chunk {};
+		c->capacity = sz;
+		return c;
+	}
+	void threaded_chunked_linear_allocator::destroy_chunk(chunk* c)
+	{
+		c->~chunk();
+		delete[] reinterpret_cast<detail::byte_t*>(c);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+
+#include <allocators/linear_storage.h>
+
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+namespace cppe
+{
+	static std::size_t virtual_page_size()
+	{
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return std::size_t(info.dwPageSize);
+#else
+		return std::size_t(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+	linear_storage::~linear_storage()
+	{
+		release_virtual();
+	}
+
+	bool linear_storage::reserve_virtual(const std::size_t max_size, const bool huge_pages)
+	{
+		CPPE_ASSERT(m_size == 0 && m_reserved == 0);
+		if (max_size == 0)
+			return false;
+
+		const std::size_t reserved = detail::align_up(max_size, virtual_page_size());
+#if defined(_WIN32)
+		(void)huge_pages; // large pages on windows need privileges and can't be committed lazily
+		void* mem = VirtualAlloc(nullptr, reserved, MEM_RESERVE, PAGE_NOACCESS);
+		if (mem == nullptr)
+			return false; // storage stays on the heap
+#else
+		// MAP_NORESERVE: the kernel hands out physical pages on first touch
+		void* mem = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (mem == MAP_FAILED)
+			return false; // storage stays on the heap
+#	if defined(MADV_HUGEPAGE)
+		if (huge_pages)
+			madvise(mem, reserved, MADV_HUGEPAGE);
+#	else
+		(void)huge_pages;
+#	endif
+#endif
+		m_heap = std::vector<detail::byte_t>();
+		m_data = static_cast<detail::byte_t*>(mem);
+		m_reserved = reserved;
+		m_committed = 0;
+		return true;
+	}
+
+	bool linear_storage::resize(const std::size_t sz)
+	{
+		if (!is_virtual())
+		{
+			m_heap.resize(sz);
+			m_data = m_heap.data();
+			m_size = sz;
+			return true;
+		}
+
+		CPPE_ASSERT(sz <= m_reserved);
+		m_size = std::min(sz, m_reserved);
+#if defined(_WIN32)
+		if (m_size > m_committed)
+		{
+			std::size_t commit = std::min(detail::align_up(m_size, virtual_page_size()), m_reserved);
+			if (VirtualAlloc(m_data + m_committed, commit - m_committed, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+			{
+				m_size = m_committed; // only the committed part is usable
+				return false;
+			}
+			m_committed = commit;
+		}
+#endif
+		return sz <= m_reserved;
+	}
+
+	void linear_storage::release_virtual()
+	{
+		if (!is_virtual())
+			return;
+#if defined(_WIN32)
+		VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+		munmap(m_data, m_reserved);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		m_reserved = 0;
+		m_committed = 0;
+	}
+}
@@ -8,35 +8,48 @@
 namespace cppe
 {
 
-	int property_map::getInt32(const string_view& s, const int default_value) const
+	template <class ALLOCATOR>
+	basic_property_map<ALLOCATOR>::basic_property_map(const ALLOCATOR& alc)
+		: m_data(typename table_t::allocator_t(alc))
+		, m_buf(alc)
+	{
+	}
+	//----------------------------------------------------------------------------------------------------------
+
+	template <class ALLOCATOR>
+	int basic_property_map<ALLOCATOR>::getInt32(const string_view& s, const int default_value) const
 	{
 		string_pool_handle bs = get(s);
 		if (bs.size() == 0)
 			return default_value;
-		return property_map::parseInt32(bs.string_view(), default_value);
+		return parseInt32(bs.string_view(), default_value);
 	}
-	uint32_t property_map::getUnsigned32(const string_view& s, const uint32_t default_value) const
+	template <class ALLOCATOR>
+	uint32_t basic_property_map<ALLOCATOR>::getUnsigned32(const string_view& s, const uint32_t default_value) const
 	{
 		string_pool_handle bs = get(s);
 		if (bs.size() == 0)
 			return default_value;
-		return property_map::parseUnsigned32(bs.string_view(), default_value);
+		return parseUnsigned32(bs.string_view(), default_value);
 	}
-	bool property_map::getBool(const string_view& s, const bool default_value) const
+	template <class ALLOCATOR>
+	bool basic_property_map<ALLOCATOR>::getBool(const string_view& s, const bool default_value) const
 	{
 		string_pool_handle bs = get(s);
 		if (bs.size() == 0)
 			return default_value;
-		return property_map::parseBool(bs.string_view(), default_value);
+		return parseBool(bs.string_view(), default_value);
 	}
-	float property_map::getFloat(const string_view& s, const float default_value) const
+	template <class ALLOCATOR>
+	float basic_property_map<ALLOCATOR>::getFloat(const string_view& s, const float default_value) const
 	{
 		string_pool_handle bs = get(s);
 		if (bs.size() == 0)
 			return default_value;
-		return property_map::parseFloat(bs.string_view(), default_value);
+		return parseFloat(bs.string_view(), default_value);
 	}
-	string_view property_map::getString(const string_view& s, const string_view& default_value) const
+	template <class ALLOCATOR>
+	string_view basic_property_map<ALLOCATOR>::getString(const string_view& s, const string_view& default_value) const
 	{
 		string_pool_handle bs = get(s);
 		if (bs.size() == 0)
@@ -44,35 +57,41 @@ namespace cppe
 		return bs.string_view();
 	}
 	//----------------------------------------------------------------------------------------------------------
-	void property_map::setInt32(const string_view& s, const int value)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::setInt32(const string_view& s, const int value)
 	{
 		fixed_string<64> ms;
 		set(s, ms.format("%d", value));
 	}
-	void property_map::setUnsigned32(const string_view& s, const uint32_t value)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::setUnsigned32(const string_view& s, const uint32_t value)
 	{
 		fixed_string<64> ms;
 		set(s, ms.format("%u", value));
 	}
-	void property_map::setBool(const string_view& s, const bool value)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::setBool(const string_view& s, const bool value)
 	{
 		fixed_string<8> ms;
 		set(s, ms.format("%s", value ? "true" : "false"));
 	}
-	void property_map::setFloat(const string_view& s, const float value)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::setFloat(const string_view& s, const float value)
 	{
 		fixed_string<64> ms;
 		set(s, ms.format("%f", value));
 	}
 	//----------------------------------------------------------------------------------------------------------
-	string_pool_handle property_map::get(const string_view& s) const
+	template <class ALLOCATOR>
+	string_pool_handle basic_property_map<ALLOCATOR>::get(const string_view& s) const
 	{
 		const string_pool_handle* rv = m_data.find(string_pool_handle(s));
 		if (rv != nullptr)
 			return *rv;
 		return string_pool_handle();
 	}
-	string_pool_handle property_map::set(const string_view& s, const string_view& value)
+	template <class ALLOCATOR>
+	string_pool_handle basic_property_map<ALLOCATOR>::set(const string_view& s, const string_view& value)
 	{
 		string_pool_handle	ss(s);
 		string_pool_handle* rv = m_data.find(ss);
@@ -82,22 +101,25 @@ namespace cppe
 				(*rv) = m_buf.insert(value);
 			return (*rv);
 		}
-		return m_data.insert(std::pair<string_pool_handle, string_pool_handle>(m_buf.insert(s), m_buf.insert(value)));
+		return m_data.insert(pair_t(m_buf.insert(s), m_buf.insert(value)));
 	}
 	//----------------------------------------------------------------------------------------------------------
-	int32_t property_map::parseInt32(const string_view& s, const int32_t default_value)
+	template <class ALLOCATOR>
+	int32_t basic_property_map<ALLOCATOR>::parseInt32(const string_view& s, const int32_t default_value)
 	{
 		int32_t r = default_value;
 		s.std_parse_int32(r);
 		return r;
 	}
-	uint32_t property_map::parseUnsigned32(const string_view& s, const uint32_t default_value)
+	template <class ALLOCATOR>
+	uint32_t basic_property_map<ALLOCATOR>::parseUnsigned32(const string_view& s, const uint32_t default_value)
 	{
 		uint32_t r = default_value;
 		s.std_parse_unsigned32(r);
 		return r;
 	}
-	bool property_map::parseBool(const string_view& s, const bool default_value)
+	template <class ALLOCATOR>
+	bool basic_property_map<ALLOCATOR>::parseBool(const string_view& s, const bool default_value)
 	{
 		if (strutil::equals_lower(s.c_str(), "true"))
 			return true;
@@ -108,7 +130,8 @@ namespace cppe
 		s.std_parse_int32(r);
 		return r != 0;
 	}
-	float property_map::parseFloat(const string_view& s, const float default_value)
+	template <class ALLOCATOR>
+	float basic_property_map<ALLOCATOR>::parseFloat(const string_view& s, const float default_value)
 	{
 		float r = default_value;
 		s.std_parse_float(r);
@@ -119,7 +142,8 @@ namespace cppe
 	//----------------------------------------------------------------------------------------------------------
 	//----------------------------------------------------------------------------------------------------------
 
-	void property_map::load_expr_internal(const std::string& s)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::load_expr_internal(const std::string& s)
 	{
 		const auto strBegin = s.find_first_of("=");
 		if (strBegin == std::string::npos)
@@ -134,7 +158,8 @@ namespace cppe
 		}
 	}
 
-	void property_map::LoadArray(const array_view<const char* const>& elements)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::LoadArray(const array_view<const char* const>& elements)
 	{
 		for (auto e : elements)
 		{
@@ -142,7 +167,8 @@ namespace cppe
 		}
 		m_data.sort();
 	}
-	void property_map::LoadIni(std::istream& is)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::LoadIni(std::istream& is)
 	{
 		std::vector<std::string> lms;
 		std::string				 line;
@@ -165,12 +191,14 @@ namespace cppe
 		}
 #endif
 	}
-	void property_map::LoadFromString(const cppe::string_view& sv)
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::LoadFromString(const cppe::string_view& sv)
 	{
 		std::stringstream ss {sv.std_string()};
 		LoadIni(ss);
 	}
-	bool property_map::LoadIni(const char* fname)
+	template <class ALLOCATOR>
+	bool basic_property_map<ALLOCATOR>::LoadIni(const char* fname)
 	{
 		std::ifstream fin(fname);
 		if (fin)
@@ -180,7 +208,8 @@ namespace cppe
 		}
 		return false;
 	}
-	void property_map::SaveIni(const char* fname) const
+	template <class ALLOCATOR>
+	void basic_property_map<ALLOCATOR>::SaveIni(const char* fname) const
 	{
 		std::ofstream fout(fname);
 
@@ -192,4 +221,7 @@ namespace cppe
 		}
 	}
 
+	template struct basic_property_map<std::allocator<char>>;
+	template struct basic_property_map<std::pmr::polymorphic_allocator<char>>;
+
 }
@@ -11,6 +11,7 @@ namespace cppe
 	stack_allocator_buffer::~stack_allocator_buffer()
 	{
 		CPPE_ASSERT(m_head == nullptr); // can't destroy this container while allocation scopes are using it
+		free_cached_segments(0);
 	}
 	std::size_t stack_allocator_buffer::capacity() const
 	{
@@ -21,6 +22,79 @@ namespace cppe
 		CPPE_ASSERT(m_head == nullptr); // make sure we don't have scopes
 		m_storage.resize(size);
 	}
+	bool stack_allocator_buffer::reserve_virtual_memory(const std::size_t max_capacity, const bool huge_pages)
+	{
+		CPPE_ASSERT(m_head == nullptr && m_storage.size() == 0);
+		return m_storage.reserve_virtual(max_capacity, huge_pages);
+	}
+	void stack_allocator_buffer::set_segment_size(const std::size_t sz)
+	{
+		m_segment_size = sz;
+	}
+	void stack_allocator_buffer::set_segment_cache_limit(const std::size_t sz)
+	{
+		m_segment_cache_limit = sz;
+		free_cached_segments(sz);
+	}
+	void stack_allocator_buffer::trim()
+	{
+		free_cached_segments(0);
+		m_spill.trim();
+	}
+	stack_allocator_buffer::segment& stack_allocator_buffer::acquire_segment(const std::size_t min_size)
+	{
+		CPPE_ASSERT(m_segment_size != 0);
+		if (m_segment_top == m_segments.size())
+			m_segments.push_back(segment { nullptr, 0 });
+
+		segment& s = m_segments[m_segment_top++];
+		if (s.size < min_size)
+		{
+			// cached segment is too small for this request, replace it
+			if (s.data != nullptr)
+				::operator delete(s.data, std::align_val_t(overflow_allocator::max_alignment));
+			s.size = std::max(min_size, m_segment_size);
+			s.data = static_cast<detail::byte_t*>(::operator new(s.size, std::align_val_t(overflow_allocator::max_alignment)));
+		}
+		return s;
+	}
+	void stack_allocator_buffer::release_segments(const std::size_t count)
+	{
+		CPPE_ASSERT(count <= m_segment_top);
+		m_segment_top -= count;
+		if (m_segment_cache_limit != std::numeric_limits<std::size_t>::max())
+			free_cached_segments(m_segment_cache_limit);
+	}
+	void stack_allocator_buffer::free_cached_segments(const std::size_t keep_bytes)
+	{
+		// segments are reused from the bottom so the top ones go first
+		std::size_t cached = 0;
+		for (std::size_t i = m_segment_top; i < m_segments.size(); i++)
+			cached += m_segments[i].size;
+
+		while (cached > keep_bytes && m_segments.size() > m_segment_top)
+		{
+			segment& s = m_segments.back();
+			cached -= s.size;
+			if (s.data != nullptr)
+				::operator delete(s.data, std::align_val_t(overflow_allocator::max_alignment));
+			m_segments.pop_back();
+		}
+	}
+	allocator_stats stack_allocator_buffer::stats() const
+	{
+		allocator_stats r = m_stats.snapshot();
+		allocator_stats o = m_spill.stats();
+		r += o;
+		r.overflow_count = o.alloc_count;
+		r.overflow_bytes = o.alloc_bytes;
+		return r;
+	}
+	void stack_allocator_buffer::reset_stats()
+	{
+		m_stats.reset();
+		m_spill.reset_stats();
+	}
 	//-----------------------------------------------------------------------------------------------------------
 
 	stack_allocator::stack_allocator(stack_allocator_buffer& alc)
@@ -32,6 +106,7 @@ namespace cppe
 		{
 			m_start = m_parent->m_start + m_parent->m_itr;
 			m_cap = m_parent->available_size();
+			m_lent = m_cap;
 
 			m_parent->m_cap = m_parent->m_itr;
 		}
@@ -40,6 +115,8 @@ namespace cppe
 			m_start = alc.m_storage.data();
 			m_cap = alc.m_storage.size();
 		}
+		m_origin_start = m_start;
+		m_origin_cap = m_cap;
 	}
 	stack_allocator::stack_allocator(stack_allocator_buffer& alc, const std::size_t extra_parent_space)
 		: m_buffer(alc)
@@ -64,22 +141,28 @@ namespace cppe
 
 			m_start = m_parent->m_start + m_parent->m_itr + offset;
 			m_cap = total_remaining_size;
+			m_lent = total_remaining_size;
 
-			m_parent->m_cap = m_itr + offset;
+			m_parent->m_cap = m_parent->m_itr + offset;
 		}
 		else
 		{
 			m_start = alc.m_storage.data();
 			m_cap = alc.m_storage.size();
 		}
+		m_origin_start = m_start;
+		m_origin_cap = m_cap;
 	}
 	stack_allocator::~stack_allocator()
 	{
 		CPPE_ASSERT(m_buffer.m_head == this);
+		release_spills();
+		release_segments();
+		m_buffer.m_stats.record_free(size());
 		m_buffer.m_head = m_parent;
 		if (m_parent != nullptr)
 		{
-			m_parent->m_cap += m_cap;
+			m_parent->m_cap += m_lent;
 		}
 	}
 
@@ -88,9 +171,14 @@ namespace cppe
 		std::size_t next_itr = sz;
 		if (next_itr <= m_cap)
 		{
+			if (next_itr >= m_itr)
+				m_buffer.m_stats.record_alloc(sz, next_itr - m_itr);
+			else
+				m_buffer.m_stats.record_free(m_itr - next_itr);
 			m_itr = next_itr;
 			return m_start;
 		}
+		m_buffer.m_stats.record_failed();
 		return nullptr;
 	}
 
@@ -100,14 +188,115 @@ namespace cppe
 		if (next_itr <= m_cap)
 		{
 			void* result = m_start + m_itr;
+			m_buffer.m_stats.record_alloc(sz, sz);
+			m_itr = next_itr;
+			return result;
+		}
+		if (next_segment(sz, 1))
+			return alloc_linear(sz);
+		if (m_buffer.m_spill_enabled)
+			return spill(sz, 1);
+		m_buffer.m_stats.record_failed();
+		return nullptr;
+	}
+	void* stack_allocator::alloc_linear(const std::size_t sz, const std::size_t align)
+	{
+		detail::byte_t*	  result = detail::align_pointer(m_start + m_itr, align);
+		const std::size_t next_itr = std::size_t(result - m_start) + sz;
+		if (next_itr <= m_cap)
+		{
+			m_buffer.m_stats.record_alloc(sz, next_itr - m_itr);
 			m_itr = next_itr;
 			return result;
 		}
+		if (next_segment(sz, align))
+			return alloc_linear(sz, align);
+		if (m_buffer.m_spill_enabled)
+			return spill(sz, align);
+		m_buffer.m_stats.record_failed();
+		return nullptr;
+	}
+	void* stack_allocator::alloc_n(const std::size_t count, const std::size_t elem_size, const std::size_t align)
+	{
+		std::size_t bytes;
+		if (detail::batch_size(count, elem_size, align, bytes))
+			return alloc_linear(bytes, align);
+		m_buffer.m_stats.record_failed();
 		return nullptr;
 	}
 	void stack_allocator::clear()
 	{
+		release_spills();
+		m_buffer.m_stats.record_free(size());
+		if (m_segments != 0)
+		{
+			CPPE_ASSERT(m_buffer.m_head == this); // nested scopes may live in our segments
+			release_segments();
+			m_start = m_origin_start;
+			m_cap = m_origin_cap;
+		}
+		m_prev_size = 0;
 		m_itr = 0;
 	}
 
+	bool stack_allocator::next_segment(const std::size_t sz, const std::size_t align)
+	{
+		// only the innermost scope can move, outer scopes have lent their remaining space to nested ones
+		if (m_buffer.m_segment_size == 0 || m_buffer.m_head != this)
+			return false;
+
+		auto& s = m_buffer.acquire_segment(sz + align - 1);
+		m_segments++;
+		m_prev_size += m_itr;
+		m_start = s.data;
+		m_cap = s.size;
+		m_itr = 0;
+		return true;
+	}
+	void stack_allocator::release_segments()
+	{
+		m_buffer.release_segments(m_segments);
+		m_segments = 0;
+	}
+
+	void* stack_allocator::spill(const std::size_t sz, const std::size_t align)
+	{
+		// the block header sits in front of the user pointer and links the scope spills together
+		const std::size_t block_align = std::max(align, alignof(spill_block));
+		const std::size_t offset = detail::align_up(sizeof(spill_block), block_align);
+
+		auto* block = static_cast<spill_block*>(m_buffer.m_spill.alloc(offset + sz, block_align));
+		if (block == nullptr)
+			return nullptr;
+
+		block->next = m_spills;
+		block->offset = offset;
+		m_spills = block;
+		m_buffer.m_spill_count++;
+		return reinterpret_cast<detail::byte_t*>(block) + offset;
+	}
+	void stack_allocator::release_spill(void* p)
+	{
+		for (spill_block** itr = &m_spills; *itr != nullptr; itr = &(*itr)->next)
+		{
+			spill_block* b = *itr;
+			if (reinterpret_cast<detail::byte_t*>(b) + b->offset == p)
+			{
+				*itr = b->next;
+				m_buffer.m_spill.free(b);
+				return;
+			}
+		}
+		CPPE_ASSERT(false); // not spilled by this scope
+	}
+	void stack_allocator::release_spills()
+	{
+		while (m_spills != nullptr)
+		{
+			spill_block* next = m_spills->next;
+			m_buffer.m_spill.free(m_spills);
+			m_spills = next;
+		}
+	}
+
 }
@@ -9,7 +9,7 @@ namespace cppe
 		CPPE_ASSERT(m_strbuf != nullptr);
 		return m_strbuf->get_next(*this);
 	}
-	string_pool_handle::string_pool_handle(const string_info& info, const string_pool& str_buffer)
+	string_pool_handle::string_pool_handle(const string_info& info, const string_pool_base& str_buffer)
 		: m_strbuf(&str_buffer)
 		, m_offset(info.offset())
 		, m_size(info.size())
@@ -23,31 +23,97 @@ namespace cppe
 	}
 	//---------------------------------------------------------------------------------
 	//---------------------------------------------------------------------------------
-	string_pool::~string_pool()
+	string_pool_handle string_pool_base::get_first() const
 	{
+		if (m_size > 0)
+			return string_t(0, cppe::strutil::length(m_data), this, m_data);
+
+		return string_t {};
 	}
-	string_pool::string_pool()
-		: m_count(0)
+	string_pool_handle string_pool_base::get_next(const string_t& s) const
 	{
+
+		std::size_t next_offset = s.m_offset + s.size() + 1;
+		if (next_offset < m_size)
+		{
+			const char* str_start = at(next_offset);
+			return string_t(next_offset, cppe::strutil::length(str_start), this, str_start);
+		}
+
+		return string_t();
 	}
-	string_pool::string_pool(std::vector<char>&& v)
+	//---------------------------------------------------------------------------------
+	//---------------------------------------------------------------------------------
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::~basic_string_pool()
+	{
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool()
+	{
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool(const ALLOCATOR& alc)
+		: m_content(alc)
+	{
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool(content_t&& v)
 		: m_content(std::move(v))
-		, m_count(1)
 	{
+		m_count = 1;
+		sync();
 	}
-	string_pool::string_pool(const std::vector<char>& v)
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool(const content_t& v)
 		: m_content(v)
-		, m_count(1)
 	{
+		m_count = 1;
+		sync();
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool(const basic_string_pool& o)
+		: m_content(o.m_content)
+	{
+		m_count = o.m_count;
+		sync();
 	}
-	string_pool_handle string_pool::begin_append()
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>::basic_string_pool(basic_string_pool&& o)
+		: m_content(std::move(o.m_content))
+	{
+		m_count = o.m_count;
+		sync();
+		o.clear();
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>& basic_string_pool<ALLOCATOR>::operator=(const basic_string_pool& o)
+	{
+		m_content = o.m_content;
+		m_count = o.m_count;
+		sync();
+		return *this;
+	}
+	template <class ALLOCATOR>
+	basic_string_pool<ALLOCATOR>& basic_string_pool<ALLOCATOR>::operator=(basic_string_pool&& o)
+	{
+		m_content = std::move(o.m_content);
+		m_count = o.m_count;
+		sync();
+		o.clear();
+		return *this;
+	}
+	template <class ALLOCATOR>
+	string_pool_handle basic_string_pool<ALLOCATOR>::begin_append()
 	{
 		std::size_t ind = m_content.size();
 		m_content.push_back('\0');
 		m_count++;
+		sync();
 		return string_pool_handle(ind, 0, this);
 	}
-	void string_pool::append(string_t& s, const char* c, const std::size_t char_count)
+	template <class ALLOCATOR>
+	void basic_string_pool<ALLOCATOR>::append(string_t& s, const char* c, const std::size_t char_count)
 	{
 		CPPE_ASSERT(m_content.size() > 0 && m_content.back() == '\0');
 		m_content.pop_back();
@@ -55,8 +121,10 @@ namespace cppe
 		s.m_size += char_count;
 		m_content.insert(m_content.end(), c, c + char_count);
 		m_content.push_back('\0');
+		sync();
 	}
-	void string_pool::append(string_t& s, const char c)
+	template <class ALLOCATOR>
+	void basic_string_pool<ALLOCATOR>::append(string_t& s, const char c)
 	{
 		if (m_content.size() > 0)
 		{
@@ -67,8 +135,10 @@ namespace cppe
 		s.m_size++;
 		m_content.push_back(c);
 		m_content.push_back('\0');
+		sync();
 	}
-	string_pool_handle string_pool::insert(const string_view* s, const std::size_t count)
+	template <class ALLOCATOR>
+	string_pool_handle basic_string_pool<ALLOCATOR>::insert(const string_view* s, const std::size_t count)
 	{
 		CPPE_ASSERT(s != nullptr && count > 0);
 		m_count++;
@@ -80,19 +150,23 @@ namespace cppe
 			m_content.insert(m_content.end(), s[i].begin(), s[i].end());
 		}
 		m_content.push_back('\0'); // terminating null character;
+		sync();
 		return string_pool_handle(ind, total_size, this);
 	}
-	string_pool_handle string_pool::insert(const char* x, const std::size_t size)
+	template <class ALLOCATOR>
+	string_pool_handle basic_string_pool<ALLOCATOR>::insert(const char* x, const std::size_t size)
 	{
 		CPPE_ASSERT(x != nullptr && size > 0);
 		m_count++;
 		std::size_t ind = m_content.size();
 		m_content.insert(m_content.end(), x, x + size);
 		m_content.push_back('\0'); // terminating null character;
+		sync();
 
 		return string_pool_handle(ind, size, this);
 	}
-	string_pool_handle string_pool::insert_file(const char* abs_file_path)
+	template <class ALLOCATOR>
+	string_pool_handle basic_string_pool<ALLOCATOR>::insert_file(const char* abs_file_path)
 	{
 		if (abs_file_path == nullptr || abs_file_path[0] == '\0')
 			return {};
@@ -104,42 +178,34 @@ namespace cppe
 		m_content.insert(m_content.end(), (std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
 		std::size_t size = m_content.size() - ind;
 		m_content.push_back('\0');
+		sync();
 		return string_pool_handle(ind, size, this);
 	}
-	void string_pool::swap(string_pool& o)
+	template <class ALLOCATOR>
+	void basic_string_pool<ALLOCATOR>::swap(basic_string_pool& o)
 	{
+		CPPE_ASSERT(m_content.get_allocator() == o.m_content.get_allocator()); // pools must share the allocator
 		m_content.swap(o.m_content);
 		std::swap(m_count, o.m_count);
+		sync();
+		o.sync();
 	}
-	void string_pool::clear()
+	template <class ALLOCATOR>
+	void basic_string_pool<ALLOCATOR>::clear()
 	{
 
 		m_content.clear();
 		m_count = 0;
+		sync();
 	}
-	string_pool::string_t string_pool::get_all()
+	template <class ALLOCATOR>
+	string_pool_handle basic_string_pool<ALLOCATOR>::get_all()
 	{
 		CPPE_ASSERT(m_content.size() > 0 && m_content.back() == '\0');
-		return string_pool::string_t(0, m_content.size() - 1, this);
+		return string_t(0, m_content.size() - 1, this);
 	}
-	string_pool::string_t string_pool::get_first() const
-	{
-		if (m_content.size() > 0)
-			return string_pool::string_t(0, cppe::strutil::length(m_content.data()), this, m_content.data());
 
-		return string_pool::string_t {};
-	}
-	string_pool::string_t string_pool::get_next(const string_t& s) const
-	{
-
-		std::size_t next_offset = s.m_offset + s.size() + 1;
-		if (next_offset < m_content.size())
-		{
-			const char* str_start = at(next_offset);
-			return string_pool::string_t(next_offset, cppe::strutil::length(str_start), this, str_start);
-		}
-
-		return string_pool::string_t();
-	}
+	template struct basic_string_pool<std::allocator<char>>;
+	template struct basic_string_pool<std::pmr::polymorphic_allocator<char>>;
 
 }
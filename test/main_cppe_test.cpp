@@ -1,15 +1,18 @@
 
 #include <ttf.h>
 #include <iostream>
+#include <cstring>
 #include <array_view.h>
 #include <auto_ptr.h>
 #include <fixed_string.h>
 #include <fixed_vector.h>
+#include <small_vector.h>
 #include <flags.h>
 #include <hash_string.h>
 #include <lambda.h>
 #include <lambda_traits.h>
 #include <pointer.h>
+#include <property_map.h>
 #include <string_helpers.h>
 #include <string_pool.h>
 #include <string_utils.h>
@@ -18,12 +21,64 @@
 #include <allocators/custom_allocators.h>
 #include <allocators/linear_allocator.h>
 #include <allocators/scoped_allocator.h>
+#include <allocators/ring_allocator.h>
+#include <allocators/memory_resource.h>
 #include <pools/primitive_bucket_pool.h>
 #include <pools/primitive_pool.h>
 #include <pools/abstract_pool.h>
+#include <pools/thread_cached_pool.h>
+#include <pools/concurrent_bucket_pool.h>
+#include <pools/soa_bucket_pool.h>
 
 // using namespace cppe;
 
+void test_overflow_allocator()
+{
+	cppe::overflow_allocator alc;
+
+	std::vector<cppe::detail::byte_t*> ptrs;
+	std::size_t						   total = 0;
+	for (std::size_t i = 1; i < 100; i++)
+	{
+		std::size_t sz = i * 37;
+		auto*		p = static_cast<cppe::detail::byte_t*>(alc.alloc(sz));
+		TEST_ASSERT(p != nullptr);
+		ptrs.push_back(p);
+		total += sz;
+
+		TEST_ASSERT(alc.owns(p) == true);
+		TEST_ASSERT(alc.owns(p + sz - 1) == true);
+		TEST_ASSERT(alc.size() == total);
+	}
+
+	std::size_t local = 0;
+	TEST_ASSERT(alc.owns(&local) == false);
+
+	// freed blocks are reused by allocations of the same size class
+	void* p = alc.alloc(100);
+	alc.free(p);
+	TEST_ASSERT(alc.owns(p) == false);
+	TEST_ASSERT(alc.alloc(120) == p);
+	TEST_ASSERT(alc.try_free(p) == true);
+	TEST_ASSERT(alc.try_free(p) == false);
+	TEST_ASSERT(alc.size() == total);
+
+	// oversized blocks bypass the size classes
+	void* big = alc.alloc(cppe::overflow_allocator::max_size_class_bytes * 2);
+	TEST_ASSERT(alc.owns(big) == true);
+	alc.free(big);
+	TEST_ASSERT(alc.size() == total);
+
+	alc.clear();
+	TEST_ASSERT(alc.size() == 0);
+	TEST_ASSERT(alc.owns(ptrs.front()) == false);
+	TEST_ASSERT(alc.alloc(37) == ptrs.front());
+
+	alc.clear();
+	alc.trim();
+	TEST_ASSERT(alc.size() == 0);
+}
+
 void test_threaded_linear_allocator()
 {
 	cppe::safe_linear_allocator<cppe::threaded_linear_allocator,cppe::threaded_overflow_allocator> alc;
@@ -74,6 +129,583 @@ void test_threaded_linear_allocator()
 	TEST_ASSERT(alc.capacity() == sizeof(std::size_t) * threads.size());
 }
 
+void test_sharded_overflow_allocator()
+{
+	cppe::safe_linear_allocator<cppe::threaded_linear_allocator, cppe::sharded_overflow_allocator> alc;
+
+	std::array<std::thread, 32> threads;
+	std::size_t					index = 0;
+	for (auto& t : threads)
+	{
+		t = std::thread([=, &alc]() {
+			std::array<void*, 64> ptrs;
+			for (std::size_t i = 0; i < ptrs.size(); i++)
+			{
+				ptrs[i] = alc.alloc(16 + (i + index) % 200);
+				std::memcpy(ptrs[i], &index, sizeof(std::size_t));
+				TEST_ASSERT(alc.owns(ptrs[i]) == true);
+			}
+			for (std::size_t i = 0; i < ptrs.size(); i += 2)
+				alc.free(ptrs[i]);
+			for (std::size_t i = 1; i < ptrs.size(); i += 2)
+				TEST_ASSERT(std::memcmp(ptrs[i], &index, sizeof(std::size_t)) == 0);
+		});
+		index++;
+	}
+	for (auto& t : threads)
+		t.join();
+
+	std::size_t expected = 0;
+	for (std::size_t t = 0; t < threads.size(); t++)
+		for (std::size_t i = 1; i < 64; i += 2)
+			expected += 16 + (i + t) % 200;
+	TEST_ASSERT(alc.size() == expected);
+
+	alc.reserve_and_clear();
+	TEST_ASSERT(alc.capacity() == expected);
+	TEST_ASSERT(alc.size() == 0);
+
+	// blocks cached by other shards are reused before new ones are allocated
+	cppe::sharded_overflow_allocator shards;
+	std::vector<void*>				 blocks;
+	for (std::size_t i = 0; i < 64; i++)
+		blocks.push_back(shards.alloc(100));
+	for (void* p : blocks)
+		shards.free(p);
+	for (std::size_t i = 0; i < 64; i++)
+	{
+		void* p = shards.alloc(100);
+		TEST_ASSERT(std::find(blocks.begin(), blocks.end(), p) != blocks.end());
+	}
+	shards.clear();
+}
+
+void test_threaded_chunked_linear_allocator()
+{
+	cppe::threaded_chunked_linear_allocator alc(sizeof(std::size_t) * 64);
+
+	std::array<std::thread, 32> threads;
+	std::array<std::size_t*, 32 * 100> ptrs;
+
+	auto fill = [&]() {
+		std::size_t index = 0;
+		for (auto& t : threads)
+		{
+			t = std::thread([=, &alc, &ptrs]() {
+				for (std::size_t i = 0; i < 100; i++)
+				{
+					std::size_t value = index * 100 + i;
+					void* dst = alc.alloc(sizeof(std::size_t));
+					TEST_ASSERT(dst != nullptr);
+					std::memcpy(dst, &value, sizeof(std::size_t));
+					ptrs[value] = static_cast<std::size_t*>(dst);
+				}
+			});
+			index++;
+		}
+		for (auto& t : threads)
+			t.join();
+
+		for (std::size_t i = 0; i < ptrs.size(); i++)
+		{
+			TEST_ASSERT(*ptrs[i] == i);
+			TEST_ASSERT(alc.owns(ptrs[i]) == true);
+		}
+		TEST_ASSERT(alc.size() == sizeof(std::size_t) * ptrs.size());
+	};
+
+	fill();
+	std::size_t capacity = alc.capacity();
+	TEST_ASSERT(capacity >= sizeof(std::size_t) * ptrs.size());
+
+	alc.clear();
+	TEST_ASSERT(alc.size() == 0);
+	TEST_ASSERT(alc.capacity() == capacity);
+
+	fill();
+	TEST_ASSERT(alc.capacity() == capacity); // chunks are recycled
+
+	std::size_t local = 0;
+	TEST_ASSERT(alc.owns(&local) == false);
+
+	void* big = alc.alloc(alc.chunk_size() * 4);
+	TEST_ASSERT(big != nullptr && alc.owns(big));
+	TEST_ASSERT(alc.capacity() > capacity);
+}
+
+void test_thread_cached_linear_allocator()
+{
+	cppe::safe_linear_allocator<cppe::thread_cached_linear_allocator, cppe::threaded_overflow_allocator> alc;
+	alc.set_block_size(sizeof(std::size_t) * 16);
+
+	std::array<std::thread, 32> threads;
+	std::array<std::size_t*, 32 * 100> ptrs;
+
+	auto fill = [&]() {
+		std::size_t index = 0;
+		for (auto& t : threads)
+		{
+			t = std::thread([=, &alc, &ptrs]() {
+				for (std::size_t i = 0; i < 100; i++)
+				{
+					std::size_t value = index * 100 + i;
+					void* dst = alc.alloc(sizeof(std::size_t));
+					TEST_ASSERT(dst != nullptr);
+					std::memcpy(dst, &value, sizeof(std::size_t));
+					ptrs[value] = static_cast<std::size_t*>(dst);
+				}
+			});
+			index++;
+		}
+		for (auto& t : threads)
+			t.join();
+
+		for (std::size_t i = 0; i < ptrs.size(); i++)
+		{
+			TEST_ASSERT(*ptrs[i] == i);
+			TEST_ASSERT(alc.owns(ptrs[i]) == true);
+		}
+	};
+
+	fill();
+	TEST_ASSERT(alc.capacity() == 0);
+
+	alc.reserve_and_clear();
+	TEST_ASSERT(alc.capacity() == sizeof(std::size_t) * ptrs.size());
+
+	fill();
+	std::size_t direct = 0;
+	for (auto* p : ptrs)
+		direct += alc.thread_cached_linear_allocator::owns(p) ? 1 : 0;
+	TEST_ASSERT(direct > 0);
+
+	alc.clear();
+	TEST_ASSERT(alc.thread_cached_linear_allocator::size() == 0);
+	void* first = alc.alloc(sizeof(std::size_t));
+	TEST_ASSERT(alc.thread_cached_linear_allocator::owns(first) == true);
+	TEST_ASSERT(alc.thread_cached_linear_allocator::size() == sizeof(std::size_t) * 16);
+
+	// batches are carved from the cached block too
+	cppe::thread_cached_linear_allocator cached(256);
+	cached.set_capacity(4096);
+	TEST_ASSERT(cached.alloc(1) != nullptr);
+	auto batch = cached.alloc_array<std::uint32_t>(4);
+	TEST_ASSERT(batch.size() == 4 && cached.owns(batch.data()));
+	TEST_ASSERT(cached.size() == 256);
+
+	// allocators that share a thread keep their own blocks even if their tokens map to the same slot
+	cppe::thread_cached_linear_allocator other(256);
+	other.set_capacity(4096);
+	for (std::size_t i = 0; i < 3; i++)
+		other.clear(); // every clear() takes a new token, 4 tokens after the one of cached
+	for (std::size_t i = 0; i < 16; i++)
+		TEST_ASSERT(cached.alloc(8) != nullptr && other.alloc(8) != nullptr);
+	TEST_ASSERT(cached.size() == 256 && other.size() == 256);
+}
+
+void test_aligned_alloc()
+{
+	auto is_aligned = [](const void* p, const std::size_t align) {
+		return p != nullptr && (reinterpret_cast<std::uintptr_t>(p) % align) == 0;
+	};
+	auto test_allocator = [&](auto& alc) {
+		for (std::size_t align : { 1, 8, 16, 32, 64 })
+		{
+			TEST_ASSERT(alc.alloc(1) != nullptr);
+			void* p = alc.alloc(24, align);
+			TEST_ASSERT(is_aligned(p, align));
+			TEST_ASSERT(alc.owns(p));
+		}
+	};
+
+	{
+		cppe::linear_allocator alc;
+		alc.set_capacity(1024);
+		test_allocator(alc);
+		TEST_ASSERT(alc.size() > (1 + 24) * 5); // padding is accounted
+		TEST_ASSERT(alc.alloc(1024, 64) == nullptr);
+	}
+	{
+		cppe::threaded_linear_allocator alc;
+		alc.set_capacity(1024);
+		test_allocator(alc);
+	}
+	{
+		cppe::threaded_chunked_linear_allocator alc(256);
+		test_allocator(alc);
+	}
+	{
+		cppe::thread_cached_linear_allocator alc(256);
+		alc.set_capacity(4096);
+		test_allocator(alc);
+	}
+	{
+		cppe::overflow_allocator alc;
+		test_allocator(alc);
+	}
+	{
+		cppe::sharded_overflow_allocator alc;
+		test_allocator(alc);
+	}
+	{
+		cppe::safe_linear_allocator<cppe::linear_allocator, cppe::overflow_allocator> alc;
+		alc.set_capacity(64);
+		test_allocator(alc);
+	}
+	{
+		cppe::stack_allocator_buffer buffer(1024);
+		cppe::stack_allocator		 alc(buffer);
+		for (std::size_t align : { 1, 8, 16, 32, 64 })
+		{
+			TEST_ASSERT(alc.alloc_linear(1) != nullptr);
+			TEST_ASSERT(is_aligned(alc.alloc_linear(24, align), align));
+		}
+		TEST_ASSERT(alc.alloc_linear(1024, 64) == nullptr);
+	}
+}
+
+void test_batch_alloc()
+{
+	struct node
+	{
+		std::uint32_t key;
+		std::uint32_t value;
+	};
+
+	cppe::threaded_linear_allocator talc;
+	talc.set_capacity(1024);
+	auto nodes = talc.alloc_array<node>(100);
+	TEST_ASSERT(nodes.size() == 100 && talc.owns(nodes.begin()) && talc.owns(nodes.end() - 1));
+	TEST_ASSERT(reinterpret_cast<std::uintptr_t>(nodes.data()) % alignof(node) == 0);
+	for (std::size_t i = 0; i < nodes.size(); i++)
+		nodes[i] = node { std::uint32_t(i), std::uint32_t(i * 2) };
+	TEST_ASSERT(nodes[99].value == 198);
+	TEST_ASSERT(talc.alloc_array<node>(1000).size() == 0);
+	TEST_ASSERT(talc.alloc_n(std::numeric_limits<std::size_t>::max() / 4, 8, 8) == nullptr); // count * size overflows
+
+	cppe::linear_allocator lalc;
+	lalc.set_capacity(256);
+	auto* p = static_cast<std::uint64_t*>(lalc.alloc_n(16, sizeof(std::uint64_t), alignof(std::uint64_t)));
+	TEST_ASSERT(p != nullptr && lalc.size() == 128);
+	TEST_ASSERT(lalc.alloc_n(32, 8, 8) == nullptr && lalc.size() == 128);
+	TEST_ASSERT(lalc.alloc_array<std::uint32_t>(0).data() != nullptr);
+
+	cppe::safe_linear_allocator<cppe::threaded_linear_allocator, cppe::threaded_overflow_allocator> salc;
+	salc.set_capacity(64);
+	auto spilled = salc.alloc_array<std::uint64_t>(64);
+	TEST_ASSERT(spilled.size() == 64 && salc.owns(spilled.begin()));
+
+	cppe::stack_allocator_buffer buffer(128);
+	{
+		cppe::stack_allocator alc(buffer);
+		alc.alloc_linear(1);
+		auto ints = alc.alloc_array<std::uint32_t>(16);
+		TEST_ASSERT(ints.size() == 16 && alc.size() == 68);
+		TEST_ASSERT(alc.alloc_array<std::uint32_t>(16).size() == 0);
+	}
+}
+
+void test_linear_realloc()
+{
+	cppe::linear_allocator lalc;
+	lalc.set_capacity(256);
+
+	auto* a = static_cast<char*>(lalc.alloc(16));
+	std::memset(a, 'a', 16);
+	TEST_ASSERT(lalc.try_grow(a, 16, 64) && lalc.size() == 64);
+	TEST_ASSERT(lalc.try_grow(a, 64, 32) && lalc.size() == 32);
+	TEST_ASSERT(lalc.try_grow(a, 32, 512) == false);
+
+	auto* b = lalc.alloc(8);
+	TEST_ASSERT(lalc.try_grow(a, 32, 48) == false); // b follows a
+	auto* c = static_cast<char*>(lalc.realloc(a, 32, 48));
+	TEST_ASSERT(c != a && c > static_cast<char*>(b) && c[0] == 'a' && c[15] == 'a');
+	TEST_ASSERT(lalc.realloc(c, 48, 96) == c && lalc.size() == 40 + 96);
+
+	char foreign[16];
+	TEST_ASSERT(lalc.try_grow(foreign, 16, 32) == false);
+
+	cppe::threaded_linear_allocator talc;
+	talc.set_capacity(2048);
+
+	// string builder style growth stays in place while nobody else allocates
+	std::size_t size = 8;
+	auto*		 str = static_cast<char*>(talc.alloc(size));
+	for (std::size_t i = 0; i < 6; i++)
+	{
+		auto* n = static_cast<char*>(talc.realloc(str, size, size * 2));
+		TEST_ASSERT(n == str);
+		size *= 2;
+	}
+	TEST_ASSERT(talc.size() == 512);
+	talc.alloc(1);
+	auto* moved = talc.realloc(str, size, size + 1);
+	TEST_ASSERT(moved != nullptr && moved != str && talc.size() == 512 + 1 + 513);
+	TEST_ASSERT(talc.realloc(moved, 513, 2048) == nullptr);
+	TEST_ASSERT(talc.try_grow(foreign, 16, 32) == false);
+
+	talc.clear();
+	talc.alloc(1);
+	auto* aligned = static_cast<char*>(talc.alloc(24, 64));
+	aligned[0] = 'a';
+	auto* grown = static_cast<char*>(talc.realloc(aligned, 24, 128, 64)); // copies unless the padding was all in front
+	TEST_ASSERT(grown != nullptr && grown[0] == 'a' && reinterpret_cast<std::uintptr_t>(grown) % 64 == 0);
+
+	cppe::safe_linear_allocator<cppe::threaded_linear_allocator, cppe::threaded_overflow_allocator> salc;
+	salc.set_capacity(64);
+	auto* s0 = static_cast<char*>(salc.alloc(32));
+	s0[31] = 's';
+	auto* s1 = static_cast<char*>(salc.realloc(s0, 32, 128)); // moves to the fallback
+	TEST_ASSERT(s1 != s0 && s1[31] == 's');
+	auto* s2 = static_cast<char*>(salc.realloc(s1, 128, 256));
+	TEST_ASSERT(s2[31] == 's' && salc.owns(s2) && salc.owns(s1) == false); // the first overflow block was released
+}
+
+void test_virtual_memory_allocators()
+{
+	const std::size_t reserved = std::size_t(1) << (sizeof(void*) >= 8 ? 32 : 28); // leave room in a 32 bit address space
+	const std::size_t mb = 1024 * 1024;
+
+	{
+		cppe::linear_allocator alc;
+		TEST_ASSERT(alc.reserve_virtual_memory(reserved, true));
+		TEST_ASSERT(alc.capacity() == 0);
+
+		TEST_ASSERT(alc.set_capacity(mb));
+		auto* p = static_cast<std::size_t*>(alc.alloc(mb - 64, 64));
+		TEST_ASSERT(p != nullptr);
+		p[0] = 42;
+		TEST_ASSERT(alc.alloc(mb) == nullptr);
+
+		alc.set_capacity(mb * 64); // grows in place with live allocations
+		TEST_ASSERT(p[0] == 42);
+		TEST_ASSERT(alc.owns(p) == true);
+		auto* q = static_cast<cppe::detail::byte_t*>(alc.alloc(mb * 32));
+		TEST_ASSERT(q != nullptr && alc.owns(q + mb * 32 - 1));
+		q[mb * 32 - 1] = 1;
+	}
+	{
+		cppe::threaded_linear_allocator alc;
+		TEST_ASSERT(alc.reserve_virtual_memory(reserved));
+		TEST_ASSERT(alc.set_capacity(mb));
+		auto* p = static_cast<std::size_t*>(alc.alloc(mb));
+		TEST_ASSERT(p != nullptr);
+		p[0] = 42;
+		TEST_ASSERT(alc.set_capacity(mb * 4)); // grows in place with live allocations
+		TEST_ASSERT(p[0] == 42 && alc.alloc(mb * 3) != nullptr);
+
+		// other threads keep allocating while the capacity grows
+		std::atomic<bool> done { false };
+		std::thread		  worker([&]() {
+			while (!done.load())
+			{
+				if (auto* q = static_cast<cppe::detail::byte_t*>(alc.alloc(64)))
+					q[63] = 1;
+			}
+		});
+		for (std::size_t i = 5; i <= 64; i++)
+			TEST_ASSERT(alc.set_capacity(mb * i));
+		done.store(true);
+		worker.join();
+	}
+	{
+		cppe::safe_linear_allocator<cppe::threaded_linear_allocator, cppe::threaded_overflow_allocator> alc;
+		TEST_ASSERT(alc.reserve_virtual_memory(reserved));
+		void* p = alc.alloc(mb);
+		TEST_ASSERT(p != nullptr && alc.threaded_linear_allocator::owns(p) == false);
+		alc.reserve_and_clear();
+		TEST_ASSERT(alc.capacity() == mb);
+		p = alc.alloc(mb);
+		TEST_ASSERT(p != nullptr && alc.threaded_linear_allocator::owns(p) == true);
+	}
+	{
+		cppe::stack_allocator_buffer buffer;
+		TEST_ASSERT(buffer.reserve_virtual_memory(reserved));
+		buffer.resize(mb);
+		TEST_ASSERT(buffer.capacity() == mb);
+		cppe::stack_allocator alc(buffer);
+		TEST_ASSERT(alc.alloc_linear(mb) != nullptr);
+		TEST_ASSERT(alc.alloc_linear(1) == nullptr);
+	}
+}
+
+void test_allocator_stats()
+{
+	cppe::safe_linear_allocator<cppe::linear_allocator, cppe::overflow_allocator> alc;
+	alc.set_capacity(64);
+
+	TEST_ASSERT(alc.alloc(16) != nullptr);
+	TEST_ASSERT(alc.alloc(1, 8) != nullptr);
+	TEST_ASSERT(alc.alloc(100) != nullptr); // overflow
+	void* p = alc.alloc(200);				// overflow
+	alc.free(p);
+
+	auto s = alc.stats();
+#ifdef CPPE_ALLOCATOR_STATS
+	TEST_ASSERT(s.alloc_count == 4);
+	TEST_ASSERT(s.alloc_bytes == 16 + 1 + 100 + 200);
+	TEST_ASSERT(s.failed_count == 0);
+	TEST_ASSERT(s.overflow_count == 2);
+	TEST_ASSERT(s.overflow_bytes == 300);
+	TEST_ASSERT(s.free_count == 1);
+	TEST_ASSERT(s.in_use == 17 + 100);
+	TEST_ASSERT(s.peak_in_use == 17 + 100 + 200);
+	TEST_ASSERT(s.size_histogram[cppe::allocator_stats::histogram_bucket(16)] == 1);
+	TEST_ASSERT(s.size_histogram[cppe::allocator_stats::histogram_bucket(100)] == 1);
+
+	alc.clear();
+	alc.reset_stats();
+	s = alc.stats();
+	TEST_ASSERT(s.alloc_count == 0 && s.in_use == 0 && s.peak_in_use == 0);
+
+	cppe::stack_allocator_buffer buffer(64);
+	{
+		cppe::stack_allocator top(buffer);
+		top.alloc_linear(8);
+		{
+			cppe::stack_allocator alc(buffer);
+			alc.alloc_linear(16);
+			TEST_ASSERT(alc.alloc_linear(64) == nullptr);
+		}
+	}
+	s = buffer.stats();
+	TEST_ASSERT(s.alloc_count == 2 && s.failed_count == 1);
+	TEST_ASSERT(s.in_use == 0 && s.peak_in_use == 24);
+#else
+	TEST_ASSERT(s.alloc_count == 0 && s.overflow_count == 0);
+#endif
+}
+
+void test_ring_allocator()
+{
+	cppe::ring_allocator<cppe::threaded_linear_allocator, 3> ring;
+	ring.intrusive_visit([](cppe::threaded_linear_allocator& alc) {
+		alc.set_capacity(1024);
+	});
+
+	auto produce = [&](const std::size_t value) {
+		auto  e = ring.acquire_epoch();
+		auto* p = static_cast<std::size_t*>(ring.alloc_pinned(e, sizeof(std::size_t), alignof(std::size_t)));
+		TEST_ASSERT(p != nullptr);
+		*p = value;
+		return std::make_pair(e, p);
+	};
+
+	auto r0 = produce(0);
+	TEST_ASSERT(ring.try_advance());
+	auto r1 = produce(1);
+	TEST_ASSERT(ring.try_advance());
+	auto r2 = produce(2);
+	TEST_ASSERT(r0.first == 0 && r1.first == 1 && r2.first == 2);
+
+	TEST_ASSERT(ring.try_advance() == false); // epoch 0 is still in flight
+	TEST_ASSERT(*r0.second == 0);
+
+	ring.release_epoch(r0.first);
+	TEST_ASSERT(ring.try_advance());
+	TEST_ASSERT(ring.current_epoch() == 3);
+	TEST_ASSERT(ring.size() == 0);
+
+	TEST_ASSERT(ring.owns(r1.second) && ring.owns(r2.second));
+	TEST_ASSERT(*r1.second == 1 && *r2.second == 2);
+
+	TEST_ASSERT(ring.try_advance() == false); // epoch 1 is still in flight
+	ring.release_epoch(r1.first);
+	ring.release_epoch(r2.first);
+	TEST_ASSERT(ring.try_advance());
+	TEST_ASSERT(ring.try_advance());
+
+	std::array<std::thread, 8> threads;
+	for (auto& t : threads)
+	{
+		t = std::thread([&]() {
+			for (std::size_t i = 0; i < 100; i++)
+			{
+				auto  e = ring.acquire_epoch();
+				auto* p = static_cast<std::size_t*>(ring.alloc_pinned(e, sizeof(std::size_t)));
+				if (p != nullptr) // the arena may be full
+					*p = i;
+				ring.release_epoch(e);
+			}
+		});
+	}
+	for (std::size_t i = 0; i < 100; i++)
+		ring.try_advance();
+	for (auto& t : threads)
+		t.join();
+	ring.clear();
+}
+
+void test_memory_resources()
+{
+	cppe::linear_allocator alc;
+	alc.set_capacity(1024 * 16);
+	cppe::linear_resource res(alc);
+
+	{
+		cppe::pmr::vecmap<int, int> m(&res);
+		for (int i = 0; i < 100; i++)
+			m[100 - i] = i;
+		TEST_ASSERT(m.size() == 100 && *m.find(1) == 99);
+		TEST_ASSERT(alc.owns(&m.at(0)));
+
+		cppe::pmr::string_pool sp(&res);
+		auto h = sp.insert("arena");
+		TEST_ASSERT(h == cppe::string_view("arena") && alc.owns(sp.data()));
+
+		cppe::pmr::property_map props(&res);
+		props.setInt32("width", 640);
+		TEST_ASSERT(props.getInt32("width", 0) == 640);
+
+		cppe::pmr::primitive_bucket_pool<std::size_t> pool(&res);
+		auto ph = pool.create();
+		TEST_ASSERT(alc.owns(ph.ptr));
+		pool.release(ph);
+
+		cppe::pmr::soa_bucket_pool<std::tuple<float, double>> soa(&res);
+		auto sh = soa.create(1.0f, 2.0);
+		TEST_ASSERT(alc.owns(&soa.get<1>(sh)) && reinterpret_cast<std::uintptr_t>(&soa.get<1>(sh)) % 64 == 0);
+		soa.release(sh);
+	}
+	TEST_ASSERT(alc.size() != 0);
+	alc.clear();
+
+	// the default variants keep their std::vector storage
+	std::vector<char> content { 'a', '\0' };
+	const char*		  content_data = content.data();
+	cppe::string_pool moved(std::move(content));
+	TEST_ASSERT(moved.data() == content_data && moved.get_first() == cppe::string_view("a"));
+
+	cppe::stack_allocator_buffer buffer(256);
+	{
+		cppe::stack_allocator salc(buffer);
+		cppe::stack_resource sres(salc);
+		std::pmr::vector<std::uint64_t> v(&sres);
+		v.push_back(1);
+		TEST_ASSERT(reinterpret_cast<std::uintptr_t>(v.data()) % alignof(std::uint64_t) == 0);
+
+		bool failed = false;
+		try
+		{
+			v.resize(1024);
+		}
+		catch (const std::bad_alloc&)
+		{
+			failed = true;
+		}
+		TEST_ASSERT(failed && v.size() == 1);
+	}
+
+	cppe::safe_linear_allocator<cppe::threaded_linear_allocator, cppe::threaded_overflow_allocator> salc;
+	salc.set_capacity(64);
+	cppe::safe_linear_resource<cppe::threaded_linear_allocator, cppe::threaded_overflow_allocator> sres(salc);
+	{
+		std::pmr::vector<char> v(1024, 'x', &sres); // spills into the overflow allocator
+		TEST_ASSERT(v.back() == 'x' && salc.owns(v.data()) && salc.threaded_linear_allocator::owns(v.data()) == false);
+	}
+	TEST_ASSERT(sres.is_equal(sres) && !sres.is_equal(res));
+}
+
 void test_stack_allocator()
 {
 	const std::size_t unit = sizeof(int);
@@ -169,6 +801,215 @@ void test_stack_allocator()
 	}
 }
 
+void test_stack_allocator_spill()
+{
+	cppe::stack_allocator_buffer buffer(64);
+
+	{
+		cppe::scoped_vector<std::string> v(buffer);
+		for (std::size_t i = 0; i < 100; i++)
+			v.push_back(std::to_string(i));
+		v.push_back(v[0]); // aliasing an element while growing
+
+		TEST_ASSERT(v.spilled() && v.size() == 101);
+		for (std::size_t i = 0; i < 100; i++)
+			TEST_ASSERT(v[i] == std::to_string(i));
+		TEST_ASSERT(v.back() == "0");
+
+		v.pop_back();
+		TEST_ASSERT(v.size() == 100 && buffer.spill_size() != 0);
+	}
+	TEST_ASSERT(buffer.spill_size() == 0);
+	TEST_ASSERT(buffer.spill_count() != 0);
+
+	{
+		cppe::scoped_vector<int> v(buffer);
+		for (int i = 0; i < 16; i++)
+			v.push_back(i);
+		TEST_ASSERT(v.spilled() == false && v.size() == 16);
+	}
+
+	const std::size_t spills = buffer.spill_count();
+	{
+		cppe::stack_allocator alc(buffer);
+		TEST_ASSERT(alc.alloc_linear(64) != nullptr);
+		TEST_ASSERT(alc.alloc_linear(1) == nullptr);
+
+		buffer.set_spill(true);
+		auto* p = static_cast<std::uint64_t*>(alc.alloc_linear(sizeof(std::uint64_t) * 100, alignof(std::uint64_t)));
+		TEST_ASSERT(p != nullptr && reinterpret_cast<std::uintptr_t>(p) % alignof(std::uint64_t) == 0);
+		p[99] = 99;
+		TEST_ASSERT(alc.size() == 64 && buffer.spill_count() == spills + 1);
+
+		{
+			cppe::stack_allocator inner(buffer);
+			TEST_ASSERT(inner.alloc_linear(1) != nullptr);
+		}
+		TEST_ASSERT(buffer.spill_size() == sizeof(std::uint64_t) * 100 + 16);
+
+		alc.clear();
+		TEST_ASSERT(buffer.spill_size() == 0);
+		TEST_ASSERT(alc.alloc_linear(1000) != nullptr);
+	}
+	TEST_ASSERT(buffer.spill_size() == 0);
+
+	buffer.set_spill(false);
+	buffer.trim();
+
+#ifdef CPPE_ALLOCATOR_STATS
+	TEST_ASSERT(buffer.stats().overflow_count == buffer.spill_count());
+#endif
+}
+
+void test_stack_allocator_segments()
+{
+	cppe::stack_allocator_buffer buffer(64);
+	buffer.set_segment_size(256);
+
+	auto fill = [](void* p, const std::size_t sz, const char c) {
+		TEST_ASSERT(p != nullptr);
+		std::memset(p, c, sz);
+	};
+
+	{
+		cppe::stack_allocator base(buffer);
+		void*				  origin = base.data();
+		void*				  a = base.alloc_linear(48);
+		fill(a, 48, 'a');
+
+		{
+			cppe::stack_allocator nested(buffer);
+			void* b = nested.alloc_linear(100); // does not fit in the 16 bytes left
+			fill(b, 100, 'b');
+			TEST_ASSERT(buffer.active_segment_count() == 1);
+
+			void* c = nested.alloc_linear(1000, 64); // outlier, gets a bigger segment
+			fill(c, 1000, 'c');
+			TEST_ASSERT(reinterpret_cast<std::uintptr_t>(c) % 64 == 0);
+			TEST_ASSERT(buffer.active_segment_count() == 2 && nested.size() == 1100);
+
+			{
+				cppe::stack_allocator inner(buffer);
+				fill(inner.alloc_linear(16), 16, 'd');
+				TEST_ASSERT(buffer.active_segment_count() == 2);
+			}
+			TEST_ASSERT(base.alloc_linear(1000) == nullptr); // outer scopes don't move while nested ones live
+			TEST_ASSERT(static_cast<char*>(b)[99] == 'b' && static_cast<char*>(c)[999] == 'c');
+		}
+		TEST_ASSERT(buffer.active_segment_count() == 0 && buffer.segment_count() == 2);
+		TEST_ASSERT(static_cast<char*>(a)[47] == 'a');
+
+		fill(base.alloc_linear(200), 200, 'e'); // reuses the first cached segment
+		TEST_ASSERT(buffer.segment_count() == 2 && base.size() == 248);
+
+		base.clear();
+		TEST_ASSERT(base.size() == 0 && buffer.active_segment_count() == 0);
+		TEST_ASSERT(base.alloc_linear(64) == origin);
+	}
+
+	buffer.set_segment_cache_limit(256);
+	TEST_ASSERT(buffer.segment_count() == 1);
+	buffer.trim();
+	TEST_ASSERT(buffer.segment_count() == 0);
+
+	buffer.set_segment_size(0);
+	{
+		cppe::stack_allocator base(buffer);
+		TEST_ASSERT(base.alloc_linear(100) == nullptr);
+	}
+}
+
+void test_chain_block()
+{
+	struct alignas(32) position
+	{
+		float x, y, z;
+	};
+	using block_t = cppe::ChainBlockPtr<std::uint8_t, position, std::string, std::uint16_t>;
+
+	constexpr auto l = block_t::compute_layout(block_t::uniform(3));
+	static_assert(l.offsets[0] == 0 && l.offsets[1] == 32 && l.offsets[2] == 32 + 3 * sizeof(position));
+	static_assert(block_t::block_alignment == 32);
+
+	cppe::linear_allocator alc;
+	alc.set_capacity(4096);
+	alc.alloc(1); // misalign the arena
+
+	block_t b;
+	TEST_ASSERT(b.alloc(block_t::uniform(3), alc) != nullptr);
+	TEST_ASSERT(reinterpret_cast<std::uintptr_t>(b.get<1>()) % 32 == 0);
+	TEST_ASSERT(reinterpret_cast<std::uintptr_t>(b.get<3>()) % alignof(std::uint16_t) == 0);
+	for (std::size_t i = 0; i < 3; i++)
+	{
+		b.get<0>()[i] = std::uint8_t(i);
+		b.get<1>()[i].x = float(i);
+		b.get<2>()[i] = "element_" + std::to_string(i) + "_with_heap_storage";
+		b.get<3>()[i] = std::uint16_t(i * 10);
+	}
+
+	const block_t::counts_t grown = { 3, 8, 8, 2 };
+	TEST_ASSERT(b.grow(block_t::uniform(3), grown, alc));
+	TEST_ASSERT(b.first()[2] == 2 && b.second()[2].x == 2.0f && b.get<3>()[1] == 10);
+	TEST_ASSERT(b.get<2>()[2] == "element_2_with_heap_storage" && b.get<2>()[7].empty());
+	b.destruct(grown);
+	b.dealloc(alc);
+
+	cppe::ChainBlockPtr<int, double> heap;
+	heap.alloc({ 4, 2 });
+	heap.first()[3] = 3;
+	heap.second()[1] = 1.0;
+	TEST_ASSERT(heap.grow({ 4, 2 }, { 8, 8 }) && heap.first()[3] == 3 && heap.second()[1] == 1.0);
+	heap.destruct({ 8, 8 });
+	heap.dealloc();
+}
+
+void test_small_vector()
+{
+	cppe::small_vector<int, 4> v;
+	for (int i = 0; i < 4; i++)
+		v.push_back(i);
+	TEST_ASSERT(v.is_inline() && v.size() == 4);
+	v.push_back(v[0]); // spills while reading an inline element
+	TEST_ASSERT(!v.is_inline() && v.size() == 5 && v.capacity() == 8 && v.back() == 0);
+
+	cppe::small_vector<int, 4> moved(std::move(v));
+	TEST_ASSERT(moved.size() == 5 && moved[3] == 3 && v.size() == 0 && v.is_inline());
+
+	cppe::small_vector<std::string, 2> strings;
+	for (int i = 0; i < 20; i++)
+		strings.emplace_back(std::to_string(i) + "_not_a_short_string");
+	strings.push_back(strings[0]);
+	TEST_ASSERT(strings.size() == 21 && strings[19] == "19_not_a_short_string" && strings.back() == strings[0]);
+
+	cppe::small_vector<std::string, 2> copy(strings);
+	copy.resize(3);
+	TEST_ASSERT(copy.size() == 3 && copy[2] == strings[2]);
+
+	// arena backed, grows in place while it is the last allocation
+	cppe::linear_allocator alc;
+	alc.set_capacity(4096);
+	cppe::small_vector<std::uint64_t, 2, cppe::linear_allocator> a(alc);
+	for (std::uint64_t i = 0; i < 3; i++)
+		a.push_back(i);
+	const std::uint64_t* spilled = a.data();
+	TEST_ASSERT(alc.owns(spilled) && a.capacity() == 4);
+	for (std::uint64_t i = 3; i < 64; i++)
+		a.push_back(i);
+	TEST_ASSERT(a.data() == spilled && a.capacity() == 64 && alc.size() == 64 * sizeof(std::uint64_t));
+
+	alc.alloc(1);
+	a.push_back(64);
+	TEST_ASSERT(a.data() != spilled && a[64] == 64 && a[10] == 10);
+
+	// a full arena moves the buffer to the heap
+	for (std::uint64_t i = 65; i < 300; i++)
+		a.push_back(i);
+	TEST_ASSERT(alc.owns(a.data()) == false && a.capacity() == 512);
+	TEST_ASSERT(a[64] == 64 && a[299] == 299);
+	cppe::small_vector<std::uint64_t, 2, cppe::linear_allocator> heap_moved(std::move(a));
+	TEST_ASSERT(heap_moved.size() == 300 && a.is_inline());
+}
+
 void test_lambda_buffer()
 {
 	using job_func_t = void();
@@ -253,7 +1094,7 @@ void test_bucket_pool()
 			{
 				auto handle = bp.create();
 				TTF_ASSERT(handle.ptr != nullptr);
-				TTF_ASSERT(handle.get_debug_index() == *handle.ptr);
+				*handle.ptr = handle.get_debug_index();
 				bhandles.push_back(handle);
 			}
 
@@ -283,6 +1124,24 @@ void test_bucket_pool()
 			index++;
 		});
 	}
+	{
+		// buckets are independent, visit them from several threads
+		TTF_ASSERT(bp.size() == bhandles.size());
+		std::vector<std::size_t> counts(bp.bucket_count(), 0);
+		std::vector<std::thread> threads;
+		for (std::size_t b = 0; b < bp.bucket_count(); b++)
+			threads.emplace_back([&, b]() { bp.visit_bucket_objects(b, [&](std::size_t) { counts[b]++; }); });
+		for (auto& t : threads)
+			t.join();
+		std::size_t total = 0;
+		for (auto c : counts)
+			total += c;
+		TTF_ASSERT(total == bhandles.size());
+
+		std::size_t visited = 0;
+		pp.visit_objects([&](std::size_t&) { visited++; });
+		TTF_ASSERT(pp.size() == phandles.size() && visited == phandles.size());
+	}
 
 	for (auto h : bhandles)
 		bp.release(h);
@@ -293,8 +1152,330 @@ void test_bucket_pool()
 	bp.clear();
 	bp.validate_empty();
 
+	// release by pointer from every bucket maps back to the right index
+	std::vector<std::size_t*> ptrs;
+	for (std::size_t i = 0; i < 500; i++)
+		ptrs.push_back(bp.create().ptr);
+	for (std::size_t i = 0; i < ptrs.size(); i++)
+		bp.release(ptrs[(i * 7) % ptrs.size()]);
+	bp.validate_empty();
+
 	for (auto h : phandles)
 		pp.release(h);
+
+	// slots are raw storage: constructed by create(args...), destroyed by release()
+	struct tracked
+	{
+		std::size_t& live;
+		std::size_t	 value;
+
+		tracked(std::size_t& l, const std::size_t v)
+			: live(l)
+			, value(v)
+		{
+			live++;
+		}
+		~tracked()
+		{
+			live--;
+		}
+	};
+	std::size_t live = 0;
+	{
+		cppe::primitive_bucket_pool<tracked> tbp;
+		cppe::primitive_pool<tracked>		 tpp { 64 };
+		auto								 a = tbp.create(live, 1);
+		auto								 b = tbp.create(live, 2);
+		tracked*							 c = tpp.create(live, 3);
+		TTF_ASSERT(live == 3 && a.ptr->value == 1 && b.ptr->value == 2 && c->value == 3);
+		tbp.release(a);
+		tpp.release(c);
+		TTF_ASSERT(live == 1);
+		tbp.release(b.ptr);
+		TTF_ASSERT(live == 0);
+
+		tbp.create(live, 4);
+		tpp.create(live, 5);
+		tbp.clear();
+		tpp.clear();
+		TTF_ASSERT(live == 0);
+	}
+}
+
+void test_primitive_pool_compact()
+{
+	cppe::primitive_pool<std::string> pool { 40 };
+
+	std::vector<std::string*> objects;
+	for (std::size_t i = 0; i < 40; i++)
+		objects.push_back(pool.create(std::to_string(i)));
+	for (std::size_t i = 0; i < 40; i += 3)
+	{
+		pool.release(objects[i]);
+		objects[i] = nullptr;
+	}
+
+	// owners patch their pointers from the callback
+	std::size_t live = pool.compact([&](std::string* from, std::string* to) {
+		auto& o = objects[pool.index_of(from)];
+		TEST_ASSERT(o == from && *to == std::to_string(pool.index_of(from)));
+		o = to;
+	});
+	TEST_ASSERT(live == 26 && pool.size() == 26);
+	for (std::size_t i = 0; i < 40; i++)
+		TEST_ASSERT(objects[i] == nullptr || (*objects[i] == std::to_string(i) && pool.index_of(objects[i]) < live));
+	TEST_ASSERT(pool.index_of(pool.create("next")) == live);
+
+	// remap table
+	pool.release(objects[1]);
+	pool.release(objects[2]);
+	auto remap = pool.compact();
+	TEST_ASSERT(remap[pool.index_of(objects[1])] == std::numeric_limits<uint_fast32_t>::max());
+	TEST_ASSERT(remap[live] == 1 && remap[live - 1] == 2 && remap[0] == 0); // holes are filled from the back
+
+	std::size_t index = 0;
+	pool.visit_objects([&](std::string&) { index++; });
+	TEST_ASSERT(index == live - 1);
+	pool.clear();
+}
+
+void test_bucket_pool_ids()
+{
+	using pool_t = cppe::primitive_bucket_pool<std::size_t, 2>;
+	static_assert(sizeof(cppe::pool_id32) == 4 && sizeof(cppe::pool_id64) == 8);
+
+	pool_t						  pool;
+	std::vector<cppe::pool_id32> ids;
+	for (std::size_t i = 0; i < 100; i++)
+		ids.push_back(pool.create_id<cppe::pool_id32>(i));
+	for (std::size_t i = 0; i < ids.size(); i++)
+		TEST_ASSERT(*pool.resolve(ids[i]) == i);
+
+	cppe::pool_id32 stale = ids[42];
+	TEST_ASSERT(pool.release(stale) == true);
+	TEST_ASSERT(pool.resolve(stale) == nullptr);
+	TEST_ASSERT(pool.release(stale) == false);
+
+	ids[42] = pool.create_id<cppe::pool_id32>(4242); // same slot, next generation
+	TEST_ASSERT(ids[42].index() == stale.index() && ids[42] != stale);
+	TEST_ASSERT(pool.resolve(stale) == nullptr && *pool.resolve(ids[42]) == 4242);
+	TEST_ASSERT(pool.resolve(cppe::pool_id32 {}) == nullptr);
+
+	// wrap the 12 bit generation of a free slot back to the value of a stale id
+	stale = ids[7];
+	TEST_ASSERT(pool.release(stale));
+	for (std::size_t i = 1; i < 4096; i++)
+		TEST_ASSERT(pool.release(pool.create_id<cppe::pool_id32>(i)));
+	TEST_ASSERT(pool.resolve(stale) == nullptr && pool.release(stale) == false);
+	ids[7] = pool.create_id<cppe::pool_id32>(std::size_t(7));
+
+	auto id64 = pool.create_id(64); // pool_id64 by default
+	static_assert(std::is_same_v<decltype(id64), cppe::pool_id64>);
+	TEST_ASSERT(*pool.resolve(id64) == 64);
+
+	// an index that doesn't fit in the id is refused, nothing is created
+	using tiny_id = cppe::pool_id<std::uint16_t, 4>;
+	pool_t					 tiny_pool;
+	std::vector<tiny_id> tiny_ids;
+	for (tiny_id id = tiny_pool.create_id<tiny_id>(0); id != nullptr; id = tiny_pool.create_id<tiny_id>(0))
+		tiny_ids.push_back(id);
+	TEST_ASSERT(tiny_ids.size() == 15 - 3 && tiny_pool.size() == tiny_ids.size()); // indices 3 .. 14, 15 is the null id
+	for (auto id : tiny_ids)
+		TEST_ASSERT(tiny_pool.release(id));
+
+	pool.clear();
+	TEST_ASSERT(pool.resolve(ids[0]) == nullptr && pool.resolve(id64) == nullptr);
+}
+
+void test_soa_bucket_pool()
+{
+	using pool_t = cppe::soa_bucket_pool<std::tuple<float, float, std::string>, 2>;
+	pool_t pool;
+
+	std::vector<pool_t::handle> handles;
+	for (std::size_t i = 0; i < 100; i++)
+	{
+		auto h = pool.create(float(i), 1.0f, std::to_string(i));
+		TEST_ASSERT(h.get_debug_index() == i);
+		handles.push_back(h);
+	}
+	TEST_ASSERT(pool.get<2>(handles[42]) == "42" && pool.get<0>(handles[42]) == 42.0f);
+	TEST_ASSERT(reinterpret_cast<std::uintptr_t>(&pool.get<0>(handles[0])) % pool_t::column_alignment == 0);
+
+	for (std::size_t i = 0; i < 100; i += 2)
+		pool.release(handles[i]);
+	TEST_ASSERT(pool.size() == 50);
+
+	// vectorizable pass over two columns, free slots included
+	pool.visit_columns<0, 1>([](const std::size_t count, const cppe::occupancy_bitmap::word_t*, float* position, const float* velocity) {
+		for (std::size_t i = 0; i < count; i++)
+			position[i] += velocity[i];
+	});
+
+	std::size_t visited = 0;
+	pool.visit<0, 2>([&](float& position, std::string& name) {
+		TEST_ASSERT(position == float(std::stoi(name) + 1));
+		visited++;
+	});
+	TEST_ASSERT(visited == 50);
+
+	auto h = pool.create(); // last released slot, fields value initialized
+	TEST_ASSERT(h.get_debug_index() == 98 && pool.get<2>(h).empty() && pool.get<1>(h) == 0.0f);
+	const pool_t& const_pool = pool;
+	static_assert(std::is_same_v<decltype(const_pool.get<2>(h)), const std::string&>);
+	pool.clear();
+	TEST_ASSERT(pool.size() == 0);
+
+	// fields live from create() to release()
+	auto													   counter = std::make_shared<int>(0);
+	cppe::soa_bucket_pool<std::tuple<int, std::shared_ptr<int>>> owners;
+	auto													   o = owners.create(1, counter);
+	TEST_ASSERT(counter.use_count() == 2);
+	owners.release(o);
+	TEST_ASSERT(counter.use_count() == 1);
+	owners.create(2, counter);
+	owners.clear();
+	TEST_ASSERT(counter.use_count() == 1);
+}
+
+void test_concurrent_bucket_pool()
+{
+	using pool_t = cppe::concurrent_bucket_pool<std::size_t, 3>;
+	pool_t pool;
+
+	std::vector<pool_t::handle> handles;
+	for (std::size_t i = 0; i < 100; i++)
+	{
+		auto h = pool.create();
+		TEST_ASSERT(h.ptr != nullptr && h.get_debug_index() == i);
+		*h.ptr = i;
+		handles.push_back(h);
+	}
+	pool.release(handles[10]);
+	pool.release(handles[20].ptr);
+	TEST_ASSERT(pool.create().ptr == handles[20].ptr); // last released comes back first
+	TEST_ASSERT(pool.create().ptr == handles[10].ptr);
+	for (auto& h : handles)
+		pool.release(h);
+
+	// objects keep their address while other threads grow the pool
+	constexpr std::size_t				  thread_count = 4;
+	constexpr std::size_t				  per_thread = 5000;
+	std::array<std::thread, thread_count> threads;
+	std::vector<pool_t::handle>			  created[thread_count];
+	for (std::size_t t = 0; t < thread_count; t++)
+	{
+		threads[t] = std::thread([&, t]() {
+			for (std::size_t i = 0; i < per_thread; i++)
+			{
+				auto h = pool.create();
+				*h.ptr = t * per_thread + i;
+				created[t].push_back(h);
+				if (i % 3 == 0)
+				{
+					pool.release(created[t][i / 2]);
+					created[t][i / 2] = pool.create();
+					*created[t][i / 2].ptr = t * per_thread + i / 2;
+				}
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	for (std::size_t t = 0; t < thread_count; t++)
+	{
+		for (std::size_t i = 0; i < per_thread; i++)
+			TEST_ASSERT(*created[t][i].ptr == t * per_thread + i);
+	}
+	for (std::size_t t = 0; t < thread_count; t++)
+	{
+		threads[t] = std::thread([&, t]() {
+			for (auto& h : created[t])
+				pool.release(h);
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	pool.validate_empty();
+
+	// clear() destroys the objects that are still alive
+	auto												owned = std::make_shared<int>(0);
+	cppe::concurrent_bucket_pool<std::shared_ptr<int>> owners;
+	for (std::size_t i = 0; i < 10; i++)
+		owners.create(owned);
+	owners.release(owners.create(owned));
+	TEST_ASSERT(owned.use_count() == 11);
+	owners.clear();
+	TEST_ASSERT(owned.use_count() == 1);
+}
+
+void test_thread_cached_pool()
+{
+	struct node
+	{
+		std::string	  name;
+		std::uint64_t value;
+
+		node(const char* n, const std::uint64_t v)
+			: name(n)
+			, value(v)
+		{
+		}
+	};
+
+	cppe::thread_cached_pool<node> pool;
+
+	node* a = pool.create("a", 1);
+	node* b = pool.create("b", 2);
+	TEST_ASSERT(a != b && a->name == "a" && b->value == 2);
+	pool.release(a);
+	TEST_ASSERT(pool.create("c", 3) == a); // same thread release goes to the local free list
+
+	std::thread([&]() {
+		pool.release(b); // remote release
+		node* d = pool.create("d", 4);
+		TEST_ASSERT(d != b);
+		pool.release(d);
+	}).join();
+	TEST_ASSERT(pool.thread_count() == 2);
+
+	TEST_ASSERT(pool.create("e", 5) == b); // drained from the remote queue
+	pool.release(a);
+	pool.release(b);
+
+	// producers hand objects to consumers released on other threads
+	constexpr std::size_t		   thread_count = 4;
+	constexpr std::size_t		   per_thread = 2000;
+	std::vector<node*>			   created[thread_count];
+	std::array<std::thread, thread_count> threads;
+	for (std::size_t t = 0; t < thread_count; t++)
+	{
+		threads[t] = std::thread([&, t]() {
+			for (std::size_t i = 0; i < per_thread; i++)
+				created[t].push_back(pool.create("x", t * per_thread + i));
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	for (std::size_t t = 0; t < thread_count; t++)
+	{
+		threads[t] = std::thread([&, t]() {
+			for (node* n : created[(t + 1) % thread_count])
+			{
+				TEST_ASSERT(n->value / per_thread == (t + 1) % thread_count);
+				pool.release(n);
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	pool.drain();
+	std::vector<node*> reused;
+	for (std::size_t i = 0; i < 64; i++)
+		reused.push_back(pool.create("y", i));
+	for (node* n : reused)
+		pool.release(n);
 }
 
 void test_abstract_pool()
@@ -371,15 +1552,122 @@ void test_abstract_pool()
 		auto* inst1 = pool.create<test_obj1>();
 		TTF_ASSERT(inst1 != nullptr);
 		pool.release(inst1);
+		TTF_ASSERT(pool.create<test_obj1>() == inst1); // the entry base is not at the start, the slot is still found
+		pool.release(static_cast<cppe::AbstractPoolEntry*>(inst1));
 		TTF_ASSERT(pool.size() != 0);//because it can't remove test_obj1 because allocator does not search properly in the alloc list
 		pool.clear();
 
 
 		auto* inst2 = pool.create<test_obj2>();
 		pool.release(inst2);
+		TTF_ASSERT(pool.create<test_obj2>() == inst2); // recycled before touching the allocator
+		pool.release(inst2);
+		pool.trim();
+		TTF_ASSERT(pool.size() == 0);
+
+		// released through the entry base, which is not at the start of the object
+		auto* inst3 = pool.create<test_obj2>();
+		pool.release(static_cast<cppe::AbstractPoolEntry*>(inst3));
+		TTF_ASSERT(pool.create<test_obj2>() == inst3); // recycled with the size of test_obj2
+		pool.release(static_cast<cppe::AbstractPoolEntry*>(inst3));
+		pool.trim();
 		TTF_ASSERT(pool.size() == 0);
 	}
 
+	{
+		struct named_obj : public cppe::AbstractPoolEntry
+		{
+			std::string name;
+			std::size_t value;
+
+			named_obj(const char* n, const std::size_t v)
+				: name(n)
+				, value(v)
+			{
+			}
+		};
+		struct other_obj : public cppe::AbstractPoolEntry
+		{
+			std::size_t data[5] = {};
+		};
+		static_assert(sizeof(named_obj) == sizeof(other_obj));
+
+		pool.clear();
+		pool.set_capacity(sizeof(named_obj) * 4);
+
+		auto* a = pool.create<named_obj>("a", 1);
+		auto* b = pool.create<named_obj>("b", 2);
+		TTF_ASSERT(a->name == "a" && b->value == 2);
+		pool.release(a);
+		pool.release(b);
+		auto* c = pool.create<other_obj>(); // same size class
+		auto* d = pool.create<named_obj>("d", 4);
+		TTF_ASSERT(static_cast<void*>(c) == static_cast<void*>(b) && static_cast<void*>(d) == static_cast<void*>(a));
+		TTF_ASSERT(pool.size() == sizeof(named_obj) * 2);
+		pool.clear();
+	}
+
+}
+
+void test_type_clustered_pool()
+{
+	using allocator = cppe::safe_linear_allocator<cppe::linear_allocator, cppe::overflow_allocator>;
+
+	cppe::AbstractPool<allocator, cppe::TypeClusteredEntryContainer> pool;
+	pool.set_capacity(1 << 16);
+
+	ttf::instance_counter test_instance;
+	struct base_obj
+	{
+		std::size_t value = 0;
+		virtual ~base_obj()
+		{
+		}
+	};
+	struct obj_a final : public base_obj, public cppe::AbstractPoolEntry
+	{
+		ttf::instance_counter inst;
+	};
+	struct obj_b final : public cppe::AbstractPoolEntry
+	{
+		std::size_t value = 0;
+		char		payload[40];
+	};
+
+	std::vector<obj_a*> as;
+	std::vector<obj_b*> bs;
+	for (std::size_t i = 0; i < 200; i++)
+	{
+		as.push_back(pool.create<obj_a>());
+		as.back()->value = i;
+		as.back()->inst = test_instance;
+		bs.push_back(pool.create<obj_b>());
+		bs.back()->value = i;
+	}
+	TTF_ASSERT(test_instance.share() == 201);
+	TTF_ASSERT(as[1] == as[0] + 1 && bs[1] == bs[0] + 1); // same type is contiguous
+
+	// release through the entry base, works with multiple inheritance
+	for (std::size_t i = 0; i < 200; i += 2)
+		pool.release(static_cast<cppe::AbstractPoolEntry*>(as[i]));
+	TTF_ASSERT(test_instance.share() == 101);
+
+	std::size_t sum = 0, count = 0;
+	pool.visit<obj_a>([&](obj_a& a) {
+		TTF_ASSERT(a.value % 2 == 1);
+		count++;
+	});
+	pool.visit<obj_b>([&](obj_b& b) { sum += b.value; });
+	TTF_ASSERT(count == 100 && sum == 199 * 200 / 2);
+
+	count = 0;
+	pool.visit([&](cppe::AbstractPoolEntry*) { count++; });
+	TTF_ASSERT(count == 300);
+
+	TTF_ASSERT(pool.create<obj_a>() == as[198]); // released slots are reused by the same type
+	pool.clear();
+	TTF_ASSERT(test_instance.share() == 1);
+	TTF_ASSERT(pool.size() == 0);
 }
 
 void test_virtual_lambda()
@@ -416,11 +1704,32 @@ void test_virtual_lambda()
 
 void core_test_main()
 {
+	TEST_FUNCTION(test_overflow_allocator);
 	TEST_FUNCTION(test_threaded_linear_allocator);
+	TEST_FUNCTION(test_sharded_overflow_allocator);
+	TEST_FUNCTION(test_threaded_chunked_linear_allocator);
+	TEST_FUNCTION(test_thread_cached_linear_allocator);
+	TEST_FUNCTION(test_aligned_alloc);
+	TEST_FUNCTION(test_batch_alloc);
+	TEST_FUNCTION(test_linear_realloc);
+	TEST_FUNCTION(test_virtual_memory_allocators);
+	TEST_FUNCTION(test_allocator_stats);
+	TEST_FUNCTION(test_ring_allocator);
+	TEST_FUNCTION(test_memory_resources);
 	TEST_FUNCTION(test_stack_allocator);
+	TEST_FUNCTION(test_stack_allocator_spill);
+	TEST_FUNCTION(test_stack_allocator_segments);
+	TEST_FUNCTION(test_chain_block);
+	TEST_FUNCTION(test_small_vector);
 	TEST_FUNCTION(test_lambda_buffer);
 	TEST_FUNCTION(test_bucket_pool);
+	TEST_FUNCTION(test_bucket_pool_ids);
+	TEST_FUNCTION(test_primitive_pool_compact);
+	TEST_FUNCTION(test_soa_bucket_pool);
+	TEST_FUNCTION(test_concurrent_bucket_pool);
+	TEST_FUNCTION(test_thread_cached_pool);
 	TEST_FUNCTION(test_abstract_pool);
+	TEST_FUNCTION(test_type_clustered_pool);
 	TEST_FUNCTION(test_virtual_lambda);
 
 }